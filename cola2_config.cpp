@@ -0,0 +1,532 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cerrno>
+#include <cmath>
+#include <iomanip>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+
+// Data-output configuration client for the scanner's CoLa2 TCP interface.
+// Reads the current UDP data-output settings of one channel and, if asked, rewrites them so the device
+// only sends the blocks (and the angular range) our consumers use: fewer bytes per scan means fewer
+// fragments, fewer recv calls and less decode work on the receiving side.
+// --mock runs a local device that speaks the same subset of CoLa2, for testing without a scanner.
+// Variable/method indices and the settings layout follow SICK's public safety scanner driver.
+// Usage: ./cola2_config --device IP[:PORT] [--channel N] [--blocks LIST] [--angles START END]
+//                       [--host IP] [--udp-port P] [--enable | --disable]
+//        ./cola2_config --mock [--listen PORT]
+//   LIST: comma-separated of state,derived,measurement,intrusion,application (or "all")
+
+constexpr int COLA2_PORT = 2122;
+constexpr uint32_t COLA2_STX = 0x02020202;
+constexpr size_t COLA2_HEADER_SIZE = 19;        // STX, length, hub, NoC, socket, session, request, type, mode
+constexpr size_t MAX_TELEGRAM_SIZE = 65536;
+constexpr uint8_t SESSION_TIMEOUT_S = 60;
+constexpr uint32_t CLIENT_ID = 0x55445054;      // "UDPT"
+// Data-output settings: read variable / change method, channel 1..4
+constexpr uint16_t VAR_COMM_SETTINGS_BASE = 0x00b2;
+constexpr uint16_t METHOD_CHANGE_COMM_SETTINGS = 0x00b0;
+constexpr int MAX_CHANNELS = 4;
+// Angles on the wire are in 1/4194304 degree
+constexpr double ANGLE_SCALE = 4194304.0;
+constexpr double MAX_ANGLE_DEG = 360.0;         // Well inside the int32 wire range (+-512 deg)
+constexpr int UDP_DATA_PORT = 1217;
+
+// Block spacing (size + padding) in the recorded 3544-byte scans, used for the bytes-per-scan estimate
+constexpr size_t SCAN_HEADER_BYTES = 76;
+constexpr size_t BLOCK_FIXED_BYTES[5] = {20, 28, 8, 280, 272};  // Measurement: + 4 per beam
+constexpr int RECORDED_BEAMS = 715;
+constexpr double RECORDED_RESOLUTION_DEG = 275.0 / RECORDED_BEAMS;
+constexpr size_t MS3_FRAGMENT_PAYLOAD = 1436;
+
+enum DataBlock { GENERAL_SYSTEM_STATE = 0, DERIVED_VALUES, MEASUREMENT_DATA, INTRUSION_DATA, APPLICATION_DATA };
+const char* BLOCK_NAMES[5] = {"state", "derived", "measurement", "intrusion", "application"};
+
+// --- 1. Byte Order Helpers (CoLa2 Header Big Endian, Payload Little Endian) ---
+
+void put_be32(std::vector<unsigned char>& out, uint32_t v) {
+    for (int s = 24; s >= 0; s -= 8) out.push_back((unsigned char)(v >> s));
+}
+
+void put_be16(std::vector<unsigned char>& out, uint16_t v) {
+    out.push_back((unsigned char)(v >> 8));
+    out.push_back((unsigned char)v);
+}
+
+void put_le(std::vector<unsigned char>& out, uint32_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) out.push_back((unsigned char)(v >> (8 * i)));
+}
+
+uint32_t get_be(const unsigned char* p, int bytes) {
+    uint32_t v = 0;
+    for (int i = 0; i < bytes; i++) v = (v << 8) | p[i];
+    return v;
+}
+
+uint32_t get_le(const unsigned char* p, int bytes) {
+    uint32_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+// --- 2. CoLa2 Telegrams ---
+
+struct Telegram {
+    uint32_t session_id = 0;
+    uint16_t request_id = 0;
+    char type = 0;                  // 'O' open, 'C' close, 'R' read, 'M' method, 'A' answer, 'F' failure
+    char mode = 0;
+    std::vector<unsigned char> payload;
+};
+
+std::vector<unsigned char> encode_telegram(const Telegram& t) {
+    std::vector<unsigned char> out;
+    out.reserve(COLA2_HEADER_SIZE + t.payload.size());
+    put_be32(out, COLA2_STX);
+    put_be32(out, (uint32_t)(COLA2_HEADER_SIZE - 8 + t.payload.size()));
+    out.push_back(0);               // Hub center
+    out.push_back(0);               // Number of connection
+    out.push_back(0);               // Socket index
+    put_be32(out, t.session_id);
+    put_be16(out, t.request_id);
+    out.push_back((unsigned char)t.type);
+    out.push_back((unsigned char)t.mode);
+    out.insert(out.end(), t.payload.begin(), t.payload.end());
+    return out;
+}
+
+bool read_exact(int fd, unsigned char* buffer, size_t length) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = recv(fd, buffer + done, length - done, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+/**
+ * @brief Reads one telegram from the stream, resynchronising on the STX if needed.
+ * @return false on EOF, timeout or an implausible length.
+ */
+bool receive_telegram(int fd, Telegram& t) {
+    unsigned char header[COLA2_HEADER_SIZE];
+    if (!read_exact(fd, header, 4)) return false;
+    while (get_be(header, 4) != COLA2_STX) {
+        std::memmove(header, header + 1, 3);
+        if (!read_exact(fd, header + 3, 1)) return false;
+    }
+    if (!read_exact(fd, header + 4, COLA2_HEADER_SIZE - 4)) return false;
+    size_t length = get_be(header + 4, 4);
+    if (length < COLA2_HEADER_SIZE - 8 || length > MAX_TELEGRAM_SIZE) return false;
+
+    t.session_id = get_be(header + 11, 4);
+    t.request_id = (uint16_t)get_be(header + 15, 2);
+    t.type = (char)header[17];
+    t.mode = (char)header[18];
+    t.payload.resize(length - (COLA2_HEADER_SIZE - 8));
+    return t.payload.empty() || read_exact(fd, t.payload.data(), t.payload.size());
+}
+
+bool send_telegram(int fd, const Telegram& t) {
+    std::vector<unsigned char> bytes = encode_telegram(t);
+    return send(fd, bytes.data(), bytes.size(), MSG_NOSIGNAL) == (ssize_t)bytes.size();
+}
+
+// --- 3. Data-Output Settings ---
+
+struct CommSettings {
+    uint8_t channel = 1;
+    bool enabled = false;
+    uint8_t interface_type = 0;     // 0 = UDP
+    uint32_t host_ip = 0;           // Network byte order
+    uint16_t host_port = UDP_DATA_PORT;
+    uint16_t publishing_frequency = 1;  // Every Nth scan
+    int32_t start_angle = 0;        // Both 0 = full range
+    int32_t end_angle = 0;
+    uint16_t features = 0x1F;       // One bit per DataBlock
+};
+
+constexpr size_t COMM_SETTINGS_SIZE = 22;
+
+void encode_settings(const CommSettings& s, std::vector<unsigned char>& out) {
+    put_le(out, s.channel, 1);
+    put_le(out, s.enabled ? 1 : 0, 1);
+    put_le(out, s.interface_type, 1);
+    put_le(out, 0, 1);
+    put_le(out, ntohl(s.host_ip), 4);
+    put_le(out, s.host_port, 2);
+    put_le(out, s.publishing_frequency, 2);
+    put_le(out, (uint32_t)s.start_angle, 4);
+    put_le(out, (uint32_t)s.end_angle, 4);
+    put_le(out, s.features, 2);
+}
+
+bool decode_settings(const unsigned char* p, size_t length, CommSettings& s) {
+    if (length < COMM_SETTINGS_SIZE) return false;
+    s.channel = p[0];
+    s.enabled = p[1] != 0;
+    s.interface_type = p[2];
+    s.host_ip = htonl(get_le(p + 4, 4));
+    s.host_port = (uint16_t)get_le(p + 8, 2);
+    s.publishing_frequency = (uint16_t)get_le(p + 10, 2);
+    s.start_angle = (int32_t)get_le(p + 12, 4);
+    s.end_angle = (int32_t)get_le(p + 16, 4);
+    s.features = (uint16_t)get_le(p + 20, 2);
+    return true;
+}
+
+/**
+ * @brief Bytes of one reassembled scan with these settings, from the recorded block sizes.
+ */
+size_t estimate_scan_bytes(const CommSettings& s) {
+    int beams = RECORDED_BEAMS;
+    if (s.start_angle != 0 || s.end_angle != 0) {
+        double span = (s.end_angle - s.start_angle) / ANGLE_SCALE;
+        beams = std::clamp((int)std::floor(span / RECORDED_RESOLUTION_DEG) + 1, 0, RECORDED_BEAMS);
+    }
+    size_t bytes = SCAN_HEADER_BYTES;
+    for (int b = 0; b < 5; b++) {
+        if (!(s.features & (1u << b))) continue;
+        bytes += BLOCK_FIXED_BYTES[b];
+        if (b == MEASUREMENT_DATA) bytes += 4 * (size_t)beams;
+    }
+    return bytes;
+}
+
+void print_settings(const std::string& label, const CommSettings& s) {
+    in_addr host{s.host_ip};
+    size_t bytes = estimate_scan_bytes(s);
+    std::cout << label << " channel " << (int)s.channel << ": " << (s.enabled ? "enabled" : "disabled")
+              << ", UDP to " << inet_ntoa(host) << ":" << s.host_port << ", every " << s.publishing_frequency << " scan(s)" << std::endl;
+    std::cout << "  Blocks:";
+    for (int b = 0; b < 5; b++) if (s.features & (1u << b)) std::cout << " " << BLOCK_NAMES[b];
+    std::cout << std::endl << std::fixed << std::setprecision(2) << "  Angles: ";
+    if (s.start_angle == 0 && s.end_angle == 0) std::cout << "full range";
+    else std::cout << s.start_angle / ANGLE_SCALE << " .. " << s.end_angle / ANGLE_SCALE << " deg";
+    std::cout << std::endl << "  Estimated " << bytes << " bytes per scan in "
+              << (bytes + MS3_FRAGMENT_PAYLOAD - 1) / MS3_FRAGMENT_PAYLOAD << " fragment(s)" << std::endl;
+}
+
+/**
+ * @brief Parses "measurement,intrusion" (or "all") into feature bits.
+ * @return false on an unknown block name.
+ */
+bool parse_blocks(const std::string& list, uint16_t& features) {
+    if (list == "all") { features = 0x1F; return true; }
+    features = 0;
+    std::istringstream items(list);
+    std::string name;
+    while (std::getline(items, name, ',')) {
+        auto it = std::find(std::begin(BLOCK_NAMES), std::end(BLOCK_NAMES), name);
+        if (it == std::end(BLOCK_NAMES)) return false;
+        features |= 1u << (it - std::begin(BLOCK_NAMES));
+    }
+    return features != 0;
+}
+
+// --- 4. Client Session ---
+
+class Cola2Client {
+public:
+    ~Cola2Client() {
+        if (fd < 0) return;
+        if (session_id != 0) request('C', 'X', {});
+        close(fd);
+    }
+
+    bool connect_to(const std::string& ip, int port) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        if (fd < 0 || inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) != 1) return false;
+        timeval timeout{3, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        int nodelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+        if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) { last_error = strerror(errno); return false; }
+
+        std::vector<unsigned char> payload;
+        put_le(payload, SESSION_TIMEOUT_S, 1);
+        put_le(payload, CLIENT_ID, 4);
+        Telegram reply;
+        if (!request('O', 'X', payload, &reply) || reply.type != 'O' || reply.mode != 'A') return false;
+        session_id = reply.session_id;
+        return true;
+    }
+
+    bool read_settings(int channel, CommSettings& s) {
+        std::vector<unsigned char> payload;
+        put_le(payload, VAR_COMM_SETTINGS_BASE + channel - 1, 2);
+        Telegram reply;
+        if (!request('R', 'I', payload, &reply) || reply.type != 'R' || reply.mode != 'A') return false;
+        return reply.payload.size() >= 2 && decode_settings(reply.payload.data() + 2, reply.payload.size() - 2, s);
+    }
+
+    bool write_settings(const CommSettings& s) {
+        std::vector<unsigned char> payload;
+        put_le(payload, METHOD_CHANGE_COMM_SETTINGS, 2);
+        encode_settings(s, payload);
+        Telegram reply;
+        return request('M', 'I', payload, &reply) && reply.type == 'A' && reply.mode == 'I';
+    }
+
+    std::string last_error;
+
+private:
+    bool request(char type, char mode, const std::vector<unsigned char>& payload, Telegram* reply = nullptr) {
+        Telegram t;
+        t.session_id = session_id;
+        t.request_id = ++request_id;
+        t.type = type;
+        t.mode = mode;
+        t.payload = payload;
+        if (!send_telegram(fd, t)) { last_error = strerror(errno); return false; }
+        if (!reply) return true;
+        if (!receive_telegram(fd, *reply)) { last_error = "no answer"; return false; }
+        if (reply->type == 'F' && reply->mode == 'A') {
+            std::ostringstream error;
+            error << "device error 0x" << std::hex << (reply->payload.size() >= 2 ? get_le(reply->payload.data(), 2) : 0);
+            last_error = error.str();
+            return false;
+        }
+        return true;
+    }
+
+    int fd = -1;
+    uint32_t session_id = 0;
+    uint16_t request_id = 0;
+};
+
+// --- 5. Mock Device ---
+
+/**
+ * @brief Answers open/close session, reads of the data-output settings and the change method.
+ * One client at a time, like the device's configuration port in practice.
+ */
+int run_mock(int port) {
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd, 1) < 0) {
+        std::cerr << "Error: Could not listen on port " << port << std::endl;
+        return 1;
+    }
+
+    // Factory state: channel 1 sends everything to 127.0.0.1:1217
+    CommSettings channels[MAX_CHANNELS];
+    for (int c = 0; c < MAX_CHANNELS; c++) channels[c].channel = c + 1;
+    channels[0].enabled = true;
+    channels[0].host_ip = htonl(INADDR_LOOPBACK);
+
+    std::cout << "--- Mock CoLa2 device listening on 127.0.0.1:" << port << " ---" << std::endl;
+    uint32_t next_session = 0x1000;
+    while (true) {
+        int client = accept(listen_fd, nullptr, nullptr);
+        if (client < 0) continue;
+        uint32_t session = 0;
+        Telegram t;
+        while (receive_telegram(client, t)) {
+            Telegram reply;
+            reply.request_id = t.request_id;
+            reply.session_id = session;
+            auto fail = [&](uint16_t code) { reply.type = 'F'; reply.mode = 'A'; put_le(reply.payload, code, 2); };
+
+            if (t.type == 'O' && t.mode == 'X') {
+                session = reply.session_id = next_session++;
+                reply.type = 'O';
+                reply.mode = 'A';
+            } else if (t.session_id != session || session == 0) {
+                fail(0x0001);                       // Invalid session
+            } else if (t.type == 'C' && t.mode == 'X') {
+                std::cout << "[INFO] Session 0x" << std::hex << session << std::dec << " closed" << std::endl;
+                break;
+            } else if (t.type == 'R' && t.mode == 'I' && t.payload.size() >= 2) {
+                int channel = (int)get_le(t.payload.data(), 2) - VAR_COMM_SETTINGS_BASE;
+                if (channel < 0 || channel >= MAX_CHANNELS) {
+                    fail(0x0004);                   // Unknown index
+                } else {
+                    reply.type = 'R';
+                    reply.mode = 'A';
+                    put_le(reply.payload, VAR_COMM_SETTINGS_BASE + channel, 2);
+                    encode_settings(channels[channel], reply.payload);
+                }
+            } else if (t.type == 'M' && t.mode == 'I' && t.payload.size() >= 2
+                       && get_le(t.payload.data(), 2) == METHOD_CHANGE_COMM_SETTINGS) {
+                CommSettings s;
+                if (!decode_settings(t.payload.data() + 2, t.payload.size() - 2, s) || s.channel < 1 || s.channel > MAX_CHANNELS) {
+                    fail(0x0005);                   // Invalid argument
+                } else {
+                    channels[s.channel - 1] = s;
+                    reply.type = 'A';
+                    reply.mode = 'I';
+                    print_settings("[INFO] Mock applied", s);
+                }
+            } else {
+                fail(0x0002);                       // Unsupported command
+            }
+            if (!send_telegram(client, reply)) break;
+        }
+        close(client);
+    }
+}
+
+// --- 6. Main Program ---
+
+void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " --device IP[:PORT] [--channel N] [--blocks LIST] [--angles START END]"
+              << " [--host IP] [--udp-port P] [--enable|--disable]  |  --mock [--listen PORT]" << std::endl;
+}
+
+/**
+ * @brief Parses a whole decimal integer in [min, max]; trailing text and overflow are rejected.
+ */
+bool parse_int(const std::string& text, long min, long max, int& value) {
+    if (text.empty()) return false;
+    char* end = nullptr;
+    errno = 0;
+    long parsed = std::strtol(text.c_str(), &end, 10);
+    if (errno == ERANGE || *end != '\0' || parsed < min || parsed > max) return false;
+    value = (int)parsed;
+    return true;
+}
+
+/**
+ * @brief Parses an angle in degrees within +-MAX_ANGLE_DEG.
+ */
+bool parse_angle(const std::string& text, double& value) {
+    if (text.empty()) return false;
+    char* end = nullptr;
+    errno = 0;
+    double parsed = std::strtod(text.c_str(), &end);
+    if (errno == ERANGE || *end != '\0' || !std::isfinite(parsed) || std::fabs(parsed) > MAX_ANGLE_DEG) return false;
+    value = parsed;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::string device;
+    int port = COLA2_PORT;
+    int channel = 1;
+    bool mock = false;
+    bool change = false;
+    CommSettings wanted;
+    std::string blocks, host;
+    int udp_port = -1, enable = -1;
+    double start_deg = 0, end_deg = 0;
+    bool angles = false;
+
+    // Every mistake is fatal: a typo must never end up reconfiguring a different channel, or in a read-only session
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        int values = (arg == "--mock" || arg == "--enable" || arg == "--disable") ? 0 : arg == "--angles" ? 2 : 1;
+        if (i + values >= argc) {
+            std::cerr << "Error: Missing value for " << arg << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+        std::string value = values > 0 ? argv[i + 1] : "";
+        bool ok = true;
+        if (arg == "--mock") mock = true;
+        else if (arg == "--listen") ok = parse_int(value, 1, 65535, port);
+        else if (arg == "--device") { device = value; ok = !device.empty(); }
+        else if (arg == "--channel") ok = parse_int(value, 1, MAX_CHANNELS, channel);
+        else if (arg == "--blocks") { blocks = value; change = true; }
+        else if (arg == "--host") { host = value; change = true; }
+        else if (arg == "--udp-port") { ok = parse_int(value, 1, 65535, udp_port); change = true; }
+        else if (arg == "--enable") { enable = 1; change = true; }
+        else if (arg == "--disable") { enable = 0; change = true; }
+        else if (arg == "--angles") {
+            value += std::string(" ") + argv[i + 2];
+            ok = parse_angle(argv[i + 1], start_deg) && parse_angle(argv[i + 2], end_deg);
+            angles = change = true;
+        }
+        else {
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+        if (!ok) {
+            std::cerr << "Error: Invalid value '" << value << "' for " << arg << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+        i += values;
+    }
+
+    if (mock) return run_mock(port);
+    if (device.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    size_t colon = device.find(':');
+    if (colon != std::string::npos) {
+        if (!parse_int(device.substr(colon + 1), 1, 65535, port)) {
+            std::cerr << "Error: Invalid port in --device " << device << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+        device.resize(colon);
+    }
+
+    Cola2Client client;
+    if (!client.connect_to(device, port)) {
+        std::cerr << "Error: Could not open a CoLa2 session with " << device << ":" << port << " (" << client.last_error << ")" << std::endl;
+        return 1;
+    }
+    CommSettings current;
+    if (!client.read_settings(channel, current)) {
+        std::cerr << "Error: Could not read the data-output settings (" << client.last_error << ")" << std::endl;
+        return 1;
+    }
+    print_settings("Current", current);
+    if (!change) return 0;
+
+    wanted = current;
+    wanted.channel = channel;
+    if (!blocks.empty() && !parse_blocks(blocks, wanted.features)) {
+        std::cerr << "Error: Unknown block in '" << blocks << "'" << std::endl;
+        return 1;
+    }
+    if (!host.empty() && inet_pton(AF_INET, host.c_str(), &wanted.host_ip) != 1) {
+        std::cerr << "Error: Invalid host address " << host << std::endl;
+        return 1;
+    }
+    if (udp_port > 0) wanted.host_port = udp_port;
+    if (enable >= 0) wanted.enabled = enable == 1;
+    if (angles) {
+        if (end_deg <= start_deg) { std::cerr << "Error: End angle must be greater than start angle" << std::endl; return 1; }
+        wanted.start_angle = (int32_t)std::lround(start_deg * ANGLE_SCALE);
+        wanted.end_angle = (int32_t)std::lround(end_deg * ANGLE_SCALE);
+    }
+
+    if (!client.write_settings(wanted)) {
+        std::cerr << "Error: Device rejected the new settings (" << client.last_error << ")" << std::endl;
+        return 1;
+    }
+    CommSettings applied;
+    if (!client.read_settings(channel, applied)) {
+        std::cerr << "Error: Could not read back the settings (" << client.last_error << ")" << std::endl;
+        return 1;
+    }
+    print_settings("Applied", applied);
+    size_t before = estimate_scan_bytes(current), after = estimate_scan_bytes(applied);
+    if (after < before) {
+        std::cout << "[INFO] " << before - after << " fewer bytes per scan ("
+                  << std::setprecision(1) << 100.0 * (before - after) / before << "%)" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,259 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <filesystem>
+#include <map>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <iomanip>
+#include <chrono>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// Multi-buffer CRC-CCITT verification.
+// When several scans are pending at once (many sensors completing in the same batch), their CRCs are
+// computed together: one independent CRC state per lane, advanced in lockstep over the common length.
+//   - portable build: 8 interleaved table lookups per step (independent dependency chains)
+//   - -mavx2 build:   8 lanes in one register, table lookups with vpgatherdd
+// verify_pending() picks the multi-buffer kernel automatically when more than one scan is pending.
+// Running the tool self-checks all kernels against crc16_ccitt() over ./packets and times them.
+
+constexpr size_t MS3_PREAMBLE_SIZE = 24;
+// Scans per multi-buffer call
+constexpr size_t MB_LANES = 8;
+
+// --- 1. Utility for Little Endian to Host Conversion ---
+
+inline uint32_t le_to_h_u32(uint32_t value) {
+    #if __BYTE_ORDER == __LITTLE_ENDIAN || defined(__LITTLE_ENDIAN__)
+        return value;
+    #else
+        return (value >> 24) | ((value << 8) & 0x00FF0000) | ((value >> 8) & 0x0000FF00) | (value << 24);
+    #endif
+}
+
+// --- 2. Single-Stream CRC16 (Reference and Table-Driven) ---
+
+/**
+ * @brief Byte-wise CRC-CCITT (0x1021 poly, 0x0000 init), same as checksum.cpp.
+ */
+unsigned short crc16_ccitt(const unsigned char* data, size_t length) {
+    unsigned short crc = 0x0000;
+    unsigned short poly = 0x1021;
+
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i] << 8;
+        for (int j = 0; j < 8; j++) {
+            if (crc & 0x8000) {
+                crc = (crc << 1) ^ poly;
+            } else {
+                crc <<= 1;
+            }
+        }
+    }
+    return crc;
+}
+
+// Table for the MSB-first 0x1021 polynomial. 32-bit entries so the AVX2 gather can use it directly.
+static uint32_t crc16_table[256];
+
+void initialize_crc16_table() {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint16_t crc = i << 8;
+        for (int j = 0; j < 8; j++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        crc16_table[i] = crc;
+    }
+}
+
+/**
+ * @brief Table-driven single-stream CRC, continuing from `crc`.
+ */
+inline uint16_t crc16_update(uint16_t crc, const unsigned char* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        crc = (uint16_t)((crc << 8) ^ crc16_table[((crc >> 8) ^ data[i]) & 0xFF]);
+    }
+    return crc;
+}
+
+// --- 3. Multi-Buffer CRC16 ---
+
+/**
+ * @brief Computes the CRC of up to MB_LANES buffers at once.
+ * All lanes run in lockstep over the shortest length; the remainders finish single-stream.
+ */
+void crc16_multibuffer(const unsigned char* const* data, const size_t* length, size_t lanes, uint16_t* crc_out) {
+    if (lanes == 0) return;
+    size_t common = SIZE_MAX;
+    for (size_t l = 0; l < lanes; l++) common = std::min(common, length[l]);
+
+    uint32_t crc[MB_LANES] = {};
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    if (lanes == MB_LANES) {
+        // 4 bytes per lane per iteration: one 32-bit load per lane, then 4 gathered lookups.
+        const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+        const __m256i crc_mask = _mm256_set1_epi32(0xFFFF);
+        __m256i c = _mm256_setzero_si256();
+        for (; i + 4 <= common; i += 4) {
+            uint32_t w[MB_LANES];
+            for (size_t l = 0; l < MB_LANES; l++) std::memcpy(&w[l], data[l] + i, 4);
+            __m256i words = _mm256_loadu_si256((const __m256i*)w);
+            for (int k = 0; k < 4; k++) {
+                __m256i b = _mm256_and_si256(_mm256_srli_epi32(words, 8 * k), byte_mask);
+                __m256i idx = _mm256_and_si256(_mm256_xor_si256(_mm256_srli_epi32(c, 8), b), byte_mask);
+                __m256i t = _mm256_i32gather_epi32((const int*)crc16_table, idx, 4);
+                c = _mm256_and_si256(_mm256_xor_si256(_mm256_slli_epi32(c, 8), t), crc_mask);
+            }
+        }
+        _mm256_storeu_si256((__m256i*)crc, c);
+    }
+#endif
+
+    // Interleaved lookups: the lanes are independent, so the CPU overlaps their load latencies.
+    for (; i < common; i++) {
+        for (size_t l = 0; l < lanes; l++) {
+            crc[l] = ((crc[l] << 8) ^ crc16_table[((crc[l] >> 8) ^ data[l][i]) & 0xFF]) & 0xFFFF;
+        }
+    }
+
+    for (size_t l = 0; l < lanes; l++) {
+        crc_out[l] = crc16_update((uint16_t)crc[l], data[l] + common, length[l] - common);
+    }
+}
+
+// --- 4. Verifier ---
+
+struct PendingScan {
+    const unsigned char* data;
+    size_t length;
+    uint16_t expected_crc;
+    bool valid = false;
+};
+
+/**
+ * @brief Verifies every pending scan. One scan goes through the single-stream path;
+ * two or more are processed MB_LANES at a time by the multi-buffer kernel.
+ * @return Number of scans whose CRC matched.
+ */
+size_t verify_pending(std::vector<PendingScan>& pending) {
+    size_t ok = 0;
+    if (pending.size() == 1) {
+        PendingScan& s = pending[0];
+        s.valid = crc16_update(0, s.data, s.length) == s.expected_crc;
+        return s.valid ? 1 : 0;
+    }
+
+    for (size_t first = 0; first < pending.size(); first += MB_LANES) {
+        size_t lanes = std::min(MB_LANES, pending.size() - first);
+        const unsigned char* data[MB_LANES];
+        size_t length[MB_LANES];
+        uint16_t crc[MB_LANES];
+        for (size_t l = 0; l < lanes; l++) {
+            data[l] = pending[first + l].data;
+            length[l] = pending[first + l].length;
+        }
+        crc16_multibuffer(data, length, lanes, crc);
+        for (size_t l = 0; l < lanes; l++) {
+            PendingScan& s = pending[first + l];
+            s.valid = crc[l] == s.expected_crc;
+            if (s.valid) ok++;
+        }
+    }
+    return ok;
+}
+
+// --- 5. Main Program (Self-Check and Timing over the Recordings) ---
+
+#pragma pack(push, 1)
+struct MS3_Preamble {
+    char magic[6];              // "MS3 MD"
+    uint16_t version;           // Offset 6
+    uint32_t total_length;      // Offset 8  | Length of the reassembled scan
+    uint32_t identification;    // Offset 12 | Same for all fragments of one scan
+    uint32_t fragment_offset;   // Offset 16 | Position of the payload in the scan
+    uint32_t reserved;          // Offset 20
+}; // Total size: 24 bytes
+#pragma pack(pop)
+
+int main(int argc, char** argv) {
+    using clock = std::chrono::steady_clock;
+    std::string folder = argc > 1 ? argv[1] : "./packets";
+    initialize_crc16_table();
+
+    if (!fs::exists(folder) || !fs::is_directory(folder)) {
+        std::cerr << "Error: Directory '" << folder << "' not found or is not a directory." << std::endl;
+        return 1;
+    }
+
+    // Reassemble the recorded scans
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::directory_iterator(folder)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".bin") files.push_back(entry.path());
+    }
+    std::sort(files.begin(), files.end());
+
+    struct Pending { std::vector<unsigned char> data; size_t received = 0; };
+    std::map<uint32_t, Pending> in_flight;
+    std::vector<std::vector<unsigned char>> scans;
+    for (const auto& path : files) {
+        std::ifstream file(path, std::ios::binary);
+        std::vector<unsigned char> d((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (d.size() <= MS3_PREAMBLE_SIZE || std::memcmp(d.data(), "MS3 MD", 6) != 0) continue;
+        MS3_Preamble pre;
+        std::memcpy(&pre, d.data(), sizeof(pre));
+        size_t total = le_to_h_u32(pre.total_length);
+        size_t offset = le_to_h_u32(pre.fragment_offset);
+        if (offset + d.size() - MS3_PREAMBLE_SIZE > total) continue;
+        Pending& p = in_flight[le_to_h_u32(pre.identification)];
+        p.data.resize(total);
+        std::memcpy(p.data.data() + offset, d.data() + MS3_PREAMBLE_SIZE, d.size() - MS3_PREAMBLE_SIZE);
+        p.received += d.size() - MS3_PREAMBLE_SIZE;
+        if (p.received >= total) {
+            scans.push_back(std::move(p.data));
+            in_flight.erase(le_to_h_u32(pre.identification));
+        }
+    }
+    if (scans.empty()) {
+        std::cout << "No complete scans found in " << folder << std::endl;
+        return 0;
+    }
+
+    // Self-check: every kernel must agree with the byte-wise reference
+    std::vector<PendingScan> pending;
+    for (const auto& s : scans) pending.push_back({s.data(), s.size(), crc16_ccitt(s.data(), s.size())});
+    size_t ok = verify_pending(pending);
+    std::cout << "--- Multi-buffer CRC16 over " << scans.size() << " scans ("
+#if defined(__AVX2__)
+              << "AVX2 gather"
+#else
+              << "interleaved scalar"
+#endif
+              << ", " << MB_LANES << " lanes) ---" << std::endl;
+    std::cout << "  Self-check: " << ok << "/" << pending.size() << " CRCs match crc16_ccitt()" << std::endl;
+    if (ok != pending.size()) return 1;
+
+    // Timing
+    constexpr int ROUNDS = 20;
+    auto time_it = [&](auto&& fn) {
+        auto start = clock::now();
+        for (int r = 0; r < ROUNDS; r++) fn();
+        return std::chrono::duration<double, std::micro>(clock::now() - start).count() / (ROUNDS * scans.size());
+    };
+    unsigned sink = 0;
+    double t_ref = time_it([&] { for (auto& s : pending) sink += crc16_ccitt(s.data, s.length); });
+    double t_table = time_it([&] { for (auto& s : pending) sink += crc16_update(0, s.data, s.length); });
+    double t_multi = time_it([&] { sink += verify_pending(pending); });
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  Byte-wise crc16_ccitt:   " << t_ref << " us/scan" << std::endl;
+    std::cout << "  Table single-stream:     " << t_table << " us/scan" << std::endl;
+    std::cout << "  Multi-buffer (verifier): " << t_multi << " us/scan" << std::endl;
+    std::cout << "  (sink " << sink << ")" << std::endl;
+    return 0;
+}
@@ -0,0 +1,384 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+// Redundant dual-path receiver.
+// The same MS3 stream arrives on two sockets (two ports and/or two interfaces). Fragments are
+// deduplicated by (identification, offset) in the in-flight table: each entry keeps the fragment
+// offsets seen and one coverage bitmap per path. The first copy of a fragment is used, the second
+// only updates the statistics, so a scan completes as soon as the union of both paths covers it.
+// Per path it reports fragment loss, how often it won the race and by how much (kernel timestamps).
+// Usage: ./dual_path_receiver [--path-a [IP:]PORT] [--path-b [IP:]PORT] [--if-a IFACE] [--if-b IFACE]
+// Test on loopback by sending the recordings to ports 1217 and 1218. Statistics are printed every
+// REPORT_SCANS scans and once more on SIGINT/SIGTERM, after the scans still in flight are retired.
+
+constexpr int DEFAULT_PORT_A = 1217;
+constexpr int DEFAULT_PORT_B = 1218;
+constexpr size_t MAX_PACKET_SIZE = 2048;
+constexpr size_t MS3_PREAMBLE_SIZE = 24;
+constexpr size_t MAX_SCAN_SIZE = 65536;
+// Per path: one path may be read while the other one bursts
+constexpr int RCVBUF_BYTES = 64 * 1024 * 1024;
+// Fragments tracked per scan (one bit each in the coverage bitmaps)
+constexpr size_t MAX_FRAGMENTS = 64;
+// Entries (complete or not) are kept this many identifications so late duplicates are still matched
+constexpr uint32_t DEDUP_WINDOW = 16;
+// An identification this far behind the newest one means the sensor restarted its counter
+constexpr int32_t RESTART_GAP = 1000;
+constexpr long REPORT_SCANS = 500;
+constexpr int PATHS = 2;
+
+// --- 1. Utility for Little Endian to Host Conversion ---
+
+inline uint32_t le_to_h_u32(uint32_t value) {
+    #if __BYTE_ORDER == __LITTLE_ENDIAN || defined(__LITTLE_ENDIAN__)
+        return value;
+    #else
+        return (value >> 24) | ((value << 8) & 0x00FF0000) | ((value >> 8) & 0x0000FF00) | (value << 24);
+    #endif
+}
+
+// --- 2. Data Structure Definitions (Packed) ---
+#pragma pack(push, 1)
+
+struct MS3_Preamble {
+    char magic[6];              // "MS3 MD"
+    uint16_t version;           // Offset 6
+    uint32_t total_length;      // Offset 8  | Length of the reassembled scan
+    uint32_t identification;    // Offset 12 | Same for all fragments of one scan
+    uint32_t fragment_offset;   // Offset 16 | Position of the payload in the scan
+    uint32_t reserved;          // Offset 20
+}; // Total size: 24 bytes
+
+#pragma pack(pop)
+
+// --- 3. Per-Path Statistics ---
+
+struct PathStats {
+    long datagrams = 0;
+    long first = 0;             // Fragments this path delivered before the other one
+    long duplicates = 0;        // Fragments that had already arrived on the other path
+    long strays = 0;            // New offsets for a scan that was already complete (malformed/foreign)
+    long missed = 0;            // Fragments of retired scans this path never delivered
+    long fragments_expected = 0;
+    double advantage_sum_us = 0;  // Sum of (other arrival - this arrival) when this path was first
+    double advantage_max_us = 0;
+    long advantage_count = 0;
+};
+
+PathStats path_stats[PATHS];
+
+// --- 4. Deduplicating Reassembly ---
+
+struct InFlightScan {
+    size_t total = 0;
+    size_t received = 0;                    // Unique payload bytes
+    bool complete = false;
+    uint32_t offsets[MAX_FRAGMENTS];        // Fragment offsets in arrival order; bit i below = offsets[i]
+    uint64_t arrival_ns[MAX_FRAGMENTS];     // First arrival of each fragment
+    int first_path[MAX_FRAGMENTS];
+    size_t fragment_count = 0;
+    size_t fragment_size = 0;               // Largest payload of a fragment that does not end the scan
+    uint64_t coverage[PATHS] = {};          // Which fragments each path has delivered
+    std::vector<unsigned char> data;
+};
+
+struct ScanTotals {
+    long completed = 0;
+    long rescued = 0;           // Completed only because the paths covered for each other
+    long incomplete = 0;
+};
+
+ScanTotals totals;
+std::map<uint32_t, InFlightScan> in_flight;
+volatile std::sig_atomic_t stop = 0;
+// Fragment payload size seen in complete scans; used when an incomplete scan never showed a full fragment
+size_t learned_fragment_size = 0;
+
+/**
+ * @brief Counts, for a scan leaving the window, the fragments each path missed.
+ * A complete scan's fragment count is known. For an incomplete one it is estimated from the total
+ * length and the fragment size, so fragments that both paths lost are charged to both.
+ */
+void retire_scan(const InFlightScan& scan) {
+    size_t expected = scan.fragment_count;
+    if (scan.complete) {
+        if (scan.fragment_size > 0) learned_fragment_size = scan.fragment_size;
+    } else {
+        totals.incomplete++;
+        size_t size = scan.fragment_size ? scan.fragment_size : learned_fragment_size;
+        if (size > 0) expected = std::max(expected, (scan.total + size - 1) / size);
+    }
+
+    bool single_path_complete = false;
+    for (int p = 0; p < PATHS; p++) {
+        long have = __builtin_popcountll(scan.coverage[p]);
+        path_stats[p].fragments_expected += expected;
+        path_stats[p].missed += expected - have;
+        if (have == (long)expected) single_path_complete = true;
+    }
+    if (scan.complete && !single_path_complete) totals.rescued++;
+}
+
+/**
+ * @brief Handles one datagram from `path`.
+ * @return true if it completed a scan.
+ */
+bool add_fragment(int path, const unsigned char* packet, size_t length, uint64_t arrival_ns) {
+    if (length <= MS3_PREAMBLE_SIZE || std::memcmp(packet, "MS3 MD", 6) != 0) return false;
+    MS3_Preamble pre;
+    std::memcpy(&pre, packet, sizeof(pre));
+    uint32_t id = le_to_h_u32(pre.identification);
+    size_t total = le_to_h_u32(pre.total_length);
+    size_t frag_offset = le_to_h_u32(pre.fragment_offset);
+    size_t frag_len = length - MS3_PREAMBLE_SIZE;
+    if (total > MAX_SCAN_SIZE || frag_offset + frag_len > total) return false;
+    path_stats[path].datagrams++;
+
+    if (!in_flight.empty()) {
+        int32_t behind = (int32_t)(id - in_flight.rbegin()->first);
+        if (behind < -RESTART_GAP) {
+            for (const auto& entry : in_flight) retire_scan(entry.second);
+            in_flight.clear();
+        } else if (behind < -(int32_t)DEDUP_WINDOW) {
+            return false;  // Too old: its entry has already been retired
+        }
+    }
+
+    InFlightScan& scan = in_flight[id];
+    if (scan.total == 0) {
+        scan.total = total;
+        scan.data.resize(total);
+    }
+    if (scan.total != total) return false;
+
+    // Deduplicate by offset
+    size_t index = 0;
+    while (index < scan.fragment_count && scan.offsets[index] != frag_offset) index++;
+    if (index < scan.fragment_count) {
+        uint64_t bit = 1ull << index;
+        if (scan.coverage[path] & bit) return false;  // Repeated on the same path
+        scan.coverage[path] |= bit;
+        // The sockets are drained one after the other, so the copy processed second can still have
+        // the earlier kernel timestamp; the race is decided by the timestamps
+        int winner = scan.first_path[index];
+        uint64_t later_ns = arrival_ns;
+        if (arrival_ns < scan.arrival_ns[index]) {
+            path_stats[winner].first--;
+            path_stats[winner].duplicates++;
+            path_stats[path].first++;
+            later_ns = scan.arrival_ns[index];
+            scan.arrival_ns[index] = arrival_ns;
+            scan.first_path[index] = winner = path;
+        } else {
+            path_stats[path].duplicates++;
+        }
+        double advantage_us = (double)(later_ns - scan.arrival_ns[index]) / 1000.0;
+        PathStats& w = path_stats[winner];
+        w.advantage_sum_us += advantage_us;
+        w.advantage_max_us = std::max(w.advantage_max_us, advantage_us);
+        w.advantage_count++;
+        return false;
+    }
+    // A complete scan has no buffer any more and cannot need another fragment
+    if (scan.complete) {
+        path_stats[path].strays++;
+        return false;
+    }
+    if (scan.fragment_count == MAX_FRAGMENTS) return false;
+
+    // First copy of this fragment
+    scan.offsets[index] = (uint32_t)frag_offset;
+    scan.arrival_ns[index] = arrival_ns;
+    scan.first_path[index] = path;
+    scan.coverage[path] |= 1ull << index;
+    scan.fragment_count++;
+    if (frag_offset + frag_len < total) scan.fragment_size = std::max(scan.fragment_size, frag_len);
+    path_stats[path].first++;
+    std::memcpy(scan.data.data() + frag_offset, packet + MS3_PREAMBLE_SIZE, frag_len);
+    scan.received += frag_len;
+
+    bool completed = false;
+    if (!scan.complete && scan.received >= scan.total) {
+        scan.complete = true;
+        totals.completed++;
+        completed = true;
+        // The scan would be handed to the decoder here; its buffer is no longer needed
+        std::vector<unsigned char>().swap(scan.data);
+    }
+
+    // Retire entries that fell out of the window (late duplicates can no longer arrive)
+    uint32_t newest = in_flight.rbegin()->first;
+    while (!in_flight.empty() && newest - in_flight.begin()->first > DEDUP_WINDOW) {
+        retire_scan(in_flight.begin()->second);
+        in_flight.erase(in_flight.begin());
+    }
+    return completed;
+}
+
+// --- 5. Socket Setup ---
+
+/**
+ * @brief Requests `bytes` of receive buffer, retrying with SO_RCVBUFFORCE (CAP_NET_ADMIN) when
+ * net.core.rmem_max caps it (as RcvBufTuner::apply in parse_checksum3.cpp).
+ * @return The granted size in request units; getsockopt reports twice that.
+ */
+int set_receive_buffer(int sockfd, int bytes) {
+    int granted = 0;
+    socklen_t len = sizeof(granted);
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+    getsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &granted, &len);
+    if (granted / 2 < bytes) {
+        setsockopt(sockfd, SOL_SOCKET, SO_RCVBUFFORCE, &bytes, sizeof(bytes));
+        getsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &granted, &len);
+    }
+    return granted / 2;
+}
+
+/**
+ * @brief Opens one path: [IP:]PORT, optionally pinned to an interface with SO_BINDTODEVICE.
+ */
+int open_path(const std::string& spec, const std::string& iface) {
+    std::string host = "0.0.0.0";
+    std::string port = spec;
+    size_t colon = spec.rfind(':');
+    if (colon != std::string::npos) {
+        host = spec.substr(0, colon);
+        port = spec.substr(colon + 1);
+    }
+
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd < 0) return -1;
+    int enable = 1;
+    setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable));
+    int granted = set_receive_buffer(sockfd, RCVBUF_BYTES);
+    if (granted < RCVBUF_BYTES) {
+        std::cerr << "[WARNING] Path " << spec << " receive buffer is " << granted / 1024 << " KB, not "
+                  << RCVBUF_BYTES / 1024 << " KB: raise net.core.rmem_max or grant CAP_NET_ADMIN." << std::endl;
+    }
+    if (!iface.empty() && setsockopt(sockfd, SOL_SOCKET, SO_BINDTODEVICE, iface.c_str(), iface.size()) < 0) {
+        std::cerr << "[WARNING] SO_BINDTODEVICE " << iface << " failed: " << strerror(errno) << std::endl;
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(std::atoi(port.c_str()));
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1 ||
+        bind(sockfd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(sockfd);
+        return -1;
+    }
+    fcntl(sockfd, F_SETFL, O_NONBLOCK);
+    return sockfd;
+}
+
+void report() {
+    std::cout << "[INFO] " << totals.completed << " scans completed (" << totals.rescued
+              << " only thanks to the second path, " << totals.incomplete << " incomplete)" << std::endl;
+    for (int p = 0; p < PATHS; p++) {
+        const PathStats& s = path_stats[p];
+        double loss = s.fragments_expected ? 100.0 * s.missed / s.fragments_expected : 0.0;
+        double won = (s.first + s.duplicates) ? 100.0 * s.first / (s.first + s.duplicates) : 0.0;
+        std::cout << "  Path " << (char)('A' + p) << ": " << s.datagrams << " datagrams | loss " << loss
+                  << "% | first " << won << "% | advantage when first: mean "
+                  << (s.advantage_count ? s.advantage_sum_us / s.advantage_count : 0.0) << " us, max "
+                  << s.advantage_max_us << " us";
+        if (s.strays) std::cout << " | " << s.strays << " stray fragments";
+        std::cout << std::endl;
+    }
+}
+
+// --- 6. Main Program Loop ---
+
+int main(int argc, char** argv) {
+    std::string spec[PATHS] = {std::to_string(DEFAULT_PORT_A), std::to_string(DEFAULT_PORT_B)};
+    std::string iface[PATHS];
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--path-a") spec[0] = argv[i + 1];
+        else if (arg == "--path-b") spec[1] = argv[i + 1];
+        else if (arg == "--if-a") iface[0] = argv[i + 1];
+        else if (arg == "--if-b") iface[1] = argv[i + 1];
+    }
+
+    pollfd fds[PATHS];
+    for (int p = 0; p < PATHS; p++) {
+        fds[p].fd = open_path(spec[p], iface[p]);
+        fds[p].events = POLLIN;
+        if (fds[p].fd < 0) {
+            std::cerr << "Error: Could not open path " << (char)('A' + p) << " (" << spec[p] << ")" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "--- Starting Dual-Path Receiver: A=" << spec[0] << (iface[0].empty() ? "" : "@" + iface[0])
+              << ", B=" << spec[1] << (iface[1].empty() ? "" : "@" + iface[1]) << " ---" << std::endl;
+
+    unsigned char packet_buffer[MAX_PACKET_SIZE];
+    char control[CMSG_SPACE(sizeof(timespec))];
+    long scanCounter = 0;
+    std::signal(SIGINT, [](int) { stop = 1; });
+    std::signal(SIGTERM, [](int) { stop = 1; });
+
+    while (!stop) {
+        int ready = poll(fds, PATHS, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Error in poll: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        for (int p = 0; p < PATHS; p++) {
+            if (!(fds[p].revents & POLLIN)) continue;
+            while (true) {
+                iovec iov{packet_buffer, sizeof(packet_buffer)};
+                msghdr msg{};
+                msg.msg_iov = &iov;
+                msg.msg_iovlen = 1;
+                msg.msg_control = control;
+                msg.msg_controllen = sizeof(control);
+                ssize_t received_bytes = recvmsg(fds[p].fd, &msg, 0);
+                if (received_bytes < 0) break;
+
+                // Kernel receive time: both sockets stamp with the same clock
+                uint64_t arrival_ns = 0;
+                for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+                    if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+                        timespec ts;
+                        std::memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+                        arrival_ns = (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+                    }
+                }
+                if (arrival_ns == 0) {
+                    arrival_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::system_clock::now().time_since_epoch()).count();
+                }
+
+                if (add_fragment(p, packet_buffer, received_bytes, arrival_ns) && ++scanCounter % REPORT_SCANS == 0) {
+                    report();
+                }
+            }
+        }
+    }
+
+    // Final summary: the scans still in the window count as well
+    for (const auto& entry : in_flight) retire_scan(entry.second);
+    in_flight.clear();
+    report();
+
+    for (int p = 0; p < PATHS; p++) close(fds[p].fd);
+    return 0;
+}
@@ -1,9 +1,21 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <string>
 #include <chrono>
 #include <vector>
 #include <numeric>
+#include <algorithm>
+#include <complex>
+#include <cmath>
 #include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <cctype>
+#include <csignal>
+#include <ctime>
+#include <filesystem>
 
 // Networking
 #include <sys/socket.h>
@@ -12,6 +24,46 @@
 #include <unistd.h>
 #include <fcntl.h>
 
+// FF07 interval measurement, plus jitter analysis of the intervals:
+//   - Allan deviation over octave tau values (random jitter falls as 1/sqrt(tau), drift rises)
+//   - autocorrelation of consecutive intervals (network jitter is mostly uncorrelated,
+//     host interference and scheduling shows up as correlated lags)
+//   - averaged FFT spectrum of the interval jitter (periodic interference gives peaks)
+// Everything is streamed in fixed memory, so it can run over multi-day logs.
+// Soak mode runs until interrupted, writes one binary record per datagram to rolling files bounded
+// by size and age, and appends a compact summary line every minute.
+// Usage: ./latency_measurer                 (live for 8 minutes, kernel timestamps, appends log.txt)
+//        ./latency_measurer --analyze FILE  (offline over a log.txt written by the live mode)
+//        ./latency_measurer --soak DIR [--max-file-mb N] [--max-total-mb N] [--max-age-hours N]
+
+// Allan deviation is evaluated for tau = 1, 2, 4, ... 2^(ALLAN_OCTAVES-1) intervals
+constexpr int ALLAN_OCTAVES = 16;
+// Autocorrelation lags reported
+constexpr int MAX_LAG = 64;
+// Intervals per FFT segment (power of two); segments are Hann windowed and averaged
+constexpr size_t FFT_SIZE = 1024;
+// Strongest spectral lines reported
+constexpr int SPECTRUM_PEAKS = 5;
+// A spectral line this far above the mean level counts as periodic interference
+constexpr double TONAL_PEAK_DB = 10.0;
+
+// Soak socket receive buffer: covers minutes of scans while the disk stalls on a file rotation
+constexpr int RCVBUF_BYTES = 64 * 1024 * 1024;
+
+// Soak mode defaults: one file per 64 MB or per hour, at most 4 GB or 7 days kept
+constexpr uint64_t SOAK_FILE_BYTES = 64ull << 20;
+constexpr uint64_t SOAK_TOTAL_BYTES = 4096ull << 20;
+constexpr auto SOAK_FILE_AGE = std::chrono::hours(1);
+constexpr auto SOAK_MAX_AGE = std::chrono::hours(24 * 7);
+constexpr auto SOAK_SUMMARY_INTERVAL = std::chrono::seconds(60);
+// Interval histogram: 1/16-octave buckets of microseconds (bucket 16*log2(us), ~4.4% wide)
+constexpr int SOAK_HIST_PER_OCTAVE = 16;
+constexpr int SOAK_HIST_BUCKETS = 28 * SOAK_HIST_PER_OCTAVE;
+// Largest accepted --max-age-hours (100 years); file ages are compared in nanoseconds
+constexpr uint64_t SOAK_AGE_LIMIT_HOURS = 24 * 365 * 100;
+// An identification jump larger than this is a sensor restart, not loss
+constexpr int32_t SOAK_RESYNC_GAP = 1000;
+
 bool containsFF07(const char* buf, ssize_t len) {
     if (len < 2) return false;
     for (ssize_t i = 0; i < len - 1; i++) {
@@ -23,9 +75,547 @@ bool containsFF07(const char* buf, ssize_t len) {
     return false;
 }
 
-int main() {
+/**
+ * @brief In-place iterative radix-2 FFT. The size must be a power of two.
+ */
+void fft(std::vector<std::complex<double>>& a) {
+    size_t n = a.size();
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(a[i], a[j]);
+    }
+    for (size_t len = 2; len <= n; len <<= 1) {
+        std::complex<double> step = std::polar(1.0, -2.0 * M_PI / len);
+        for (size_t i = 0; i < n; i += len) {
+            std::complex<double> w(1.0);
+            for (size_t k = 0; k < len / 2; k++) {
+                std::complex<double> u = a[i + k];
+                std::complex<double> v = a[i + k + len / 2] * w;
+                a[i + k] = u + v;
+                a[i + k + len / 2] = u - v;
+                w *= step;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Streaming jitter statistics over a sequence of intervals (seconds). Memory is
+ * O(ALLAN_OCTAVES + MAX_LAG + FFT_SIZE) no matter how many intervals are added.
+ */
+class JitterAnalyzer {
+public:
+    JitterAnalyzer() : segment(FFT_SIZE), psd(FFT_SIZE / 2 + 1, 0.0), window(FFT_SIZE) {
+        for (size_t i = 0; i < FFT_SIZE; i++) window[i] = 0.5 - 0.5 * std::cos(2.0 * M_PI * i / (FFT_SIZE - 1));
+    }
+
+    void add(double dt) {
+        count++;
+        sum += dt;
+        sumSq += dt * dt;
+        addAllan(dt);
+        addLags(dt);
+        segment[segmentFill++] = dt;
+        if (segmentFill == FFT_SIZE) flushSegment();
+    }
+
+    void report(std::ostream& out) const {
+        if (count < 2) {
+            out << "Not enough intervals for jitter analysis.\n";
+            return;
+        }
+        double mean = sum / count;
+        double stddev = std::sqrt(std::max(0.0, sumSq / count - mean * mean));
+        out << "\n--- Jitter analysis over " << count << " intervals ---\n";
+        out << "Mean interval: " << mean * 1e3 << " ms, std dev: " << stddev * 1e6 << " us\n";
+
+        out << "\nAllan deviation (tau in intervals / seconds -> ADEV us):\n";
+        for (int k = 0; k < ALLAN_OCTAVES; k++) {
+            const Octave& o = octaves[k];
+            if (o.pairs < 2) break;
+            long tau = 1L << k;
+            out << "  tau " << tau << " (" << tau * mean << " s): " << std::sqrt(o.sumSqDiff / (2.0 * o.pairs)) * 1e6
+                << " us  [" << o.pairs << " pairs]\n";
+        }
+
+        out << "\nAutocorrelation of intervals (|r| > " << 2.0 / std::sqrt((double)count) << " is significant):\n";
+        double variance = sumSq / count - mean * mean;
+        for (int lag = 1; lag <= MAX_LAG; lag++) {
+            const Lag& l = lags[lag - 1];
+            if (l.n < 2 || variance <= 0) break;
+            double cov = l.sumXY / l.n - (l.sumX / l.n) * (l.sumY / l.n);
+            double r = cov / variance;
+            if (lag <= 8 || std::abs(r) > 2.0 / std::sqrt((double)count)) {
+                out << "  lag " << lag << ": " << r << "\n";
+            }
+        }
+
+        if (segments == 0) {
+            out << "\nSpectrum: needs at least " << FFT_SIZE << " intervals.\n";
+            return;
+        }
+        // Sample rate is one interval per mean period
+        double binHz = 1.0 / (mean * FFT_SIZE);
+        std::vector<size_t> bins;
+        for (size_t b = 1; b < psd.size(); b++) bins.push_back(b);
+        std::partial_sort(bins.begin(), bins.begin() + std::min<size_t>(SPECTRUM_PEAKS, bins.size()), bins.end(),
+                          [&](size_t a, size_t b) { return psd[a] > psd[b]; });
+        double logSum = 0, linSum = 0;
+        for (size_t b = 1; b < psd.size(); b++) {
+            logSum += std::log(std::max(psd[b], 1e-300));
+            linSum += psd[b];
+        }
+        double flatness = std::exp(logSum / (psd.size() - 1)) / (linSum / (psd.size() - 1));
+        out << "\nJitter spectrum (" << segments << " segments of " << FFT_SIZE << ", "
+            << binHz << " Hz per bin, Nyquist " << binHz * FFT_SIZE / 2 << " Hz):\n";
+        for (int p = 0; p < SPECTRUM_PEAKS && p < (int)bins.size(); p++) {
+            size_t b = bins[p];
+            out << "  " << b * binHz << " Hz: " << 10.0 * std::log10(psd[b] / (linSum / (psd.size() - 1))) << " dB above mean\n";
+        }
+        // A line well above the averaged floor means something periodic is disturbing the timing
+        double peakDb = 10.0 * std::log10(psd[bins[0]] / (linSum / (psd.size() - 1)));
+        out << "  Spectral flatness: " << flatness << "\n";
+        if (peakDb > TONAL_PEAK_DB) {
+            out << "  Verdict: periodic interference near " << bins[0] * binHz << " Hz (period "
+                << 1.0 / (bins[0] * binHz) << " s)\n";
+        } else {
+            out << "  Verdict: broadband, random jitter\n";
+        }
+    }
+
+private:
+    struct Octave {
+        double blockSum = 0;   // Intervals accumulated into the current block
+        long blockFill = 0;
+        double prevMean = 0;
+        bool havePrev = false;
+        double sumSqDiff = 0;
+        long pairs = 0;
+    };
+
+    struct Lag {
+        double sumXY = 0, sumX = 0, sumY = 0;
+        long n = 0;
+    };
+
+    // Non-overlapping Allan variance of the interval series, one running block per octave
+    void addAllan(double dt) {
+        for (int k = 0; k < ALLAN_OCTAVES; k++) {
+            Octave& o = octaves[k];
+            o.blockSum += dt;
+            if (++o.blockFill < (1L << k)) continue;
+            double m = o.blockSum / o.blockFill;
+            if (o.havePrev) {
+                o.sumSqDiff += (m - o.prevMean) * (m - o.prevMean);
+                o.pairs++;
+            }
+            o.prevMean = m;
+            o.havePrev = true;
+            o.blockSum = 0;
+            o.blockFill = 0;
+        }
+    }
+
+    void addLags(double dt) {
+        for (int lag = 1; lag <= MAX_LAG && lag <= historyFill; lag++) {
+            double past = history[(historyPos + MAX_LAG - lag) % MAX_LAG];
+            Lag& l = lags[lag - 1];
+            l.sumXY += dt * past;
+            l.sumX += dt;
+            l.sumY += past;
+            l.n++;
+        }
+        history[historyPos] = dt;
+        historyPos = (historyPos + 1) % MAX_LAG;
+        historyFill = std::min(historyFill + 1, MAX_LAG);
+    }
+
+    void flushSegment() {
+        double mean = std::accumulate(segment.begin(), segment.end(), 0.0) / FFT_SIZE;
+        std::vector<std::complex<double>> x(FFT_SIZE);
+        for (size_t i = 0; i < FFT_SIZE; i++) x[i] = (segment[i] - mean) * window[i];
+        fft(x);
+        for (size_t b = 0; b < psd.size(); b++) psd[b] += std::norm(x[b]);
+        segments++;
+        segmentFill = 0;
+    }
+
+    long count = 0;
+    double sum = 0, sumSq = 0;
+    Octave octaves[ALLAN_OCTAVES];
+    Lag lags[MAX_LAG];
+    double history[MAX_LAG] = {};
+    int historyPos = 0, historyFill = 0;
+    std::vector<double> segment;
+    size_t segmentFill = 0;
+    std::vector<double> psd;
+    std::vector<double> window;
+    long segments = 0;
+};
+
+/**
+ * @brief Streams a log written by the live mode ("<ms> ms, <dt> sec" per line) through the analyzer.
+ */
+int analyzeLog(const std::string& path) {
+    std::ifstream log(path);
+    if (!log) {
+        std::cerr << "Failed to open " << path << "\n";
+        return 1;
+    }
+    JitterAnalyzer analyzer;
+    std::string line;
+    while (std::getline(log, line)) {
+        std::istringstream fields(line);
+        long long ms;
+        std::string unit;
+        double dt;
+        if (fields >> ms >> unit >> dt && dt > 0) analyzer.add(dt);
+    }
+    analyzer.report(std::cout);
+    return 0;
+}
+
+// --- Soak mode ---
+
+#pragma pack(push, 1)
+struct SoakFileHeader {
+    char magic[4];              // "SOAK"
+    uint16_t version;           // 1
+    uint16_t recordSize;        // sizeof(SoakRecord)
+    uint64_t createdNs;         // CLOCK_REALTIME at file creation
+};
+
+struct SoakRecord {
+    uint64_t arrivalNs;         // Kernel receive timestamp (CLOCK_REALTIME)
+    uint32_t intervalUs;        // Since the previous scan start (0 if this datagram does not start a scan)
+    uint32_t identification;    // MS3 identification, 0 for non-MS3 datagrams
+    uint32_t kernelDrops;       // Cumulative SO_RXQ_OVFL counter
+    uint16_t length;            // Datagram length
+    uint16_t flags;             // Bit 0: scan start
+}; // Total size: 24 bytes
+#pragma pack(pop)
+
+/**
+ * @brief Binary record files in one directory, rotated by size and age and pruned oldest-first by
+ * total size and age. The first file of the run is never pruned, so the start of a soak stays available.
+ */
+class RollingLog {
+public:
+    RollingLog(std::filesystem::path dir, uint64_t fileBytes, uint64_t totalBytes, std::chrono::hours maxAge)
+        : dir(std::move(dir)), fileBytes(fileBytes), totalBytes(totalBytes), maxAge(maxAge) {}
+
+    bool write(const SoakRecord& r) {
+        if (!file.is_open() || written + sizeof(r) > fileBytes ||
+            std::chrono::steady_clock::now() - opened >= SOAK_FILE_AGE) {
+            if (!rotate()) return false;
+        }
+        file.write((const char*)&r, sizeof(r));
+        written += sizeof(r);
+        return (bool)file;
+    }
+
+    void flush() { if (file.is_open()) file.flush(); }
+
+    std::string currentFile() const { return current.filename().string(); }
+
+private:
+    bool rotate() {
+        if (file.is_open()) file.close();
+        timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        char stamp[32];
+        tm utc;
+        gmtime_r(&now.tv_sec, &utc);
+        strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", &utc);
+        // Names sort chronologically, which is the pruning order
+        current = dir / ("soak_" + std::string(stamp) + "_" + std::to_string(sequence++) + ".bin");
+        file.open(current, std::ios::binary);
+        if (!file) {
+            std::cerr << "Failed to open " << current << "\n";
+            return false;
+        }
+        if (first.empty()) first = current;
+        SoakFileHeader header{{'S', 'O', 'A', 'K'}, 1, sizeof(SoakRecord), (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec};
+        file.write((const char*)&header, sizeof(header));
+        written = sizeof(header);
+        opened = std::chrono::steady_clock::now();
+        prune();
+        return true;
+    }
+
+    void prune() {
+        std::vector<std::filesystem::path> files;
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+            std::string name = entry.path().filename().string();
+            if (entry.is_regular_file() && name.rfind("soak_", 0) == 0 && entry.path().extension() == ".bin") {
+                files.push_back(entry.path());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        uint64_t total = 0;
+        for (const auto& f : files) total += std::filesystem::file_size(f, ec);
+
+        auto cutoff = std::filesystem::file_time_type::clock::now() - maxAge;
+        for (const auto& f : files) {
+            if (f == first || f == current) continue;
+            bool tooOld = std::filesystem::last_write_time(f, ec) < cutoff;
+            if (total <= totalBytes && !tooOld) break;
+            uint64_t size = std::filesystem::file_size(f, ec);
+            if (std::filesystem::remove(f, ec)) total -= size;
+        }
+    }
+
+    std::filesystem::path dir, current, first;
+    uint64_t fileBytes, totalBytes;
+    std::chrono::hours maxAge;
+    std::ofstream file;
+    uint64_t written = 0;
+    long sequence = 0;
+    std::chrono::steady_clock::time_point opened;
+};
+
+/**
+ * @brief Counters for one summary period. Scan-start intervals go into a log-scale histogram.
+ */
+struct SoakPeriod {
+    long datagrams = 0, scans = 0, lostScans = 0, resyncs = 0;
+    uint32_t kernelDrops = 0;
+    uint32_t maxIntervalUs = 0;
+    long hist[SOAK_HIST_BUCKETS] = {};
+
+    void addInterval(uint32_t us) {
+        int bucket = us ? (int)(SOAK_HIST_PER_OCTAVE * std::log2((double)us)) : 0;
+        hist[std::min(bucket, SOAK_HIST_BUCKETS - 1)]++;
+        maxIntervalUs = std::max(maxIntervalUs, us);
+    }
+
+    // Upper edge of the bucket holding the q-quantile, capped at the observed maximum
+    double quantileUs(double q) const {
+        long n = 0, target;
+        for (long h : hist) n += h;
+        if (n == 0) return 0;
+        target = (long)std::ceil(q * n);
+        long seen = 0;
+        for (int b = 0; b < SOAK_HIST_BUCKETS; b++) {
+            seen += hist[b];
+            if (seen >= target) return std::min<double>(std::exp2((b + 1.0) / SOAK_HIST_PER_OCTAVE), maxIntervalUs);
+        }
+        return maxIntervalUs;
+    }
+};
+
+volatile std::sig_atomic_t soakStop = 0;
+
+// Sets the receive buffer like RcvBufTuner::apply in parse_checksum3.cpp: SO_RCVBUF first, then
+// SO_RCVBUFFORCE (needs CAP_NET_ADMIN) if net.core.rmem_max capped it. Returns the size granted,
+// in the units of the request (getsockopt reports it doubled).
+int setReceiveBuffer(int sockfd, int bytes) {
+    int granted = 0;
+    socklen_t grantedLen = sizeof(granted);
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+    getsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &granted, &grantedLen);
+    if (granted / 2 < bytes) {
+        setsockopt(sockfd, SOL_SOCKET, SO_RCVBUFFORCE, &bytes, sizeof(bytes));
+        getsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &granted, &grantedLen);
+    }
+    return granted / 2;
+}
+
+int runSoak(const std::filesystem::path& dir, uint64_t fileBytes, uint64_t totalBytes, std::chrono::hours maxAge) {
+    const int PORT = 1217;
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    std::ofstream summaryFile(dir / "soak_summary.txt", std::ios::app);
+    if (!summaryFile) {
+        std::cerr << "Failed to open " << dir / "soak_summary.txt" << "\n";
+        return 1;
+    }
+
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd < 0) {
+        perror("socket");
+        return 1;
+    }
+    int enable = 1;
+    setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable));
+    setsockopt(sockfd, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable));
+    int granted = setReceiveBuffer(sockfd, RCVBUF_BYTES);
+    if (granted < RCVBUF_BYTES) {
+        // Kept in the summary too: a capped buffer explains drops found in the logs later
+        std::ostringstream warning;
+        warning << "[WARNING] SO_RCVBUF capped at " << granted / 1024 << " KB (asked for "
+                << RCVBUF_BYTES / 1024 << " KB). Raise net.core.rmem_max or grant CAP_NET_ADMIN.";
+        std::cerr << warning.str() << "\n";
+        summaryFile << warning.str() << std::endl;
+    }
+    // Blocking with a timeout: a week-long run should not spin a core
+    timeval timeout{1, 0};
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port        = htons(PORT);
+    if (bind(sockfd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("bind");
+        close(sockfd);
+        return 1;
+    }
+
+    std::signal(SIGINT, [](int) { soakStop = 1; });
+    std::signal(SIGTERM, [](int) { soakStop = 1; });
+
+    RollingLog log(dir, fileBytes, totalBytes, maxAge);
+    SoakPeriod period;
+    JitterAnalyzer analyzer;
+    char buffer[4096];
+    char control[CMSG_SPACE(sizeof(timespec)) + CMSG_SPACE(sizeof(uint32_t))];
+    uint64_t prevScanNs = 0;
+    uint32_t lastId = 0;
+    bool haveId = false;
+    uint32_t drops = 0, dropsAtPeriodStart = 0;
+    long totalDatagrams = 0, totalLost = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto nextSummary = start + SOAK_SUMMARY_INTERVAL;
+
+    std::cout << "Soak test on port " << PORT << ", writing to " << dir << " (Ctrl-C to stop).\n";
+
+    while (!soakStop) {
+        iovec iov{buffer, sizeof(buffer)};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        ssize_t received = recvmsg(sockfd, &msg, 0);
+
+        if (received > 0) {
+            SoakRecord r{};
+            timespec kts;
+            clock_gettime(CLOCK_REALTIME, &kts);
+            for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+                if (c->cmsg_level != SOL_SOCKET) continue;
+                if (c->cmsg_type == SCM_TIMESTAMPNS) std::memcpy(&kts, CMSG_DATA(c), sizeof(kts));
+                else if (c->cmsg_type == SO_RXQ_OVFL) std::memcpy(&drops, CMSG_DATA(c), sizeof(drops));
+            }
+            r.arrivalNs = (uint64_t)kts.tv_sec * 1000000000ull + kts.tv_nsec;
+            r.length = (uint16_t)received;
+            r.kernelDrops = drops;
+
+            // A scan starts with the first MS3 fragment, or with an FF07 datagram on non-MS3 streams
+            bool scanStart;
+            if (received > 24 && std::memcmp(buffer, "MS3 MD", 6) == 0) {
+                uint32_t fragmentOffset;
+                std::memcpy(&r.identification, buffer + 12, sizeof(uint32_t));
+                std::memcpy(&fragmentOffset, buffer + 16, sizeof(uint32_t));
+                scanStart = fragmentOffset == 0;
+                if (scanStart) {
+                    int32_t gap = (int32_t)(r.identification - lastId);
+                    if (haveId && (gap > SOAK_RESYNC_GAP || gap < 0)) period.resyncs++;
+                    else if (haveId && gap > 1) period.lostScans += gap - 1;
+                    lastId = r.identification;
+                    haveId = true;
+                }
+            } else {
+                scanStart = containsFF07(buffer, received);
+            }
+
+            if (scanStart) {
+                r.flags |= 1;
+                if (prevScanNs) {
+                    uint64_t dtNs = r.arrivalNs - prevScanNs;
+                    r.intervalUs = (uint32_t)std::min<uint64_t>(dtNs / 1000, UINT32_MAX);
+                    period.addInterval(r.intervalUs);
+                    analyzer.add(dtNs * 1e-9);
+                }
+                prevScanNs = r.arrivalNs;
+                period.scans++;
+            }
+            period.datagrams++;
+            if (!log.write(r)) break;
+        }
+        else if (received < 0 && errno != EWOULDBLOCK && errno != EAGAIN && errno != EINTR) {
+            perror("recvmsg");
+            break;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= nextSummary || soakStop) {
+            nextSummary = now + SOAK_SUMMARY_INTERVAL;
+            period.kernelDrops = drops - dropsAtPeriodStart;
+            dropsAtPeriodStart = drops;
+            totalDatagrams += period.datagrams;
+            totalLost += period.lostScans;
+            long elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - start).count();
+
+            // One line per period: elapsed s, datagrams, scans, lost scans, resyncs, kernel drops, p50/p99/p99.9/max interval us
+            std::ostringstream line;
+            line << "t=" << elapsed << "s dgrams=" << period.datagrams << " scans=" << period.scans
+                 << " lost=" << period.lostScans << " resyncs=" << period.resyncs << " kdrops=" << period.kernelDrops
+                 << " p50=" << (long)period.quantileUs(0.5) << "us p99=" << (long)period.quantileUs(0.99)
+                 << "us p999=" << (long)period.quantileUs(0.999) << "us max=" << period.maxIntervalUs
+                 << "us file=" << log.currentFile();
+            std::cout << line.str() << "\n";
+            summaryFile << line.str() << std::endl;
+            log.flush();
+            period = SoakPeriod();
+        }
+    }
+
+    close(sockfd);
+    log.flush();
+    std::cout << "\n--- Soak summary: " << totalDatagrams << " datagrams, " << totalLost << " scans lost, "
+              << drops << " kernel drops ---\n";
+    analyzer.report(std::cout);
+    return 0;
+}
+
+// Parses a soak limit: a whole number from 1 to `max`. Zero, signs, trailing text and overflow are rejected.
+bool parseLimit(const char* text, uint64_t max, uint64_t& value) {
+    if (!std::isdigit((unsigned char)text[0])) return false;
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long parsed = std::strtoull(text, &end, 10);
+    if (errno != 0 || *end != '\0' || parsed == 0 || parsed > max) return false;
+    value = parsed;
+    return true;
+}
+
+int main(int argc, char** argv) {
     using clock = std::chrono::steady_clock;
 
+    if (argc > 2 && std::string(argv[1]) == "--analyze") return analyzeLog(argv[2]);
+    if (argc > 2 && std::string(argv[1]) == "--soak") {
+        uint64_t fileBytes = SOAK_FILE_BYTES, totalBytes = SOAK_TOTAL_BYTES;
+        auto maxAge = std::chrono::duration_cast<std::chrono::hours>(SOAK_MAX_AGE);
+        for (int i = 3; i < argc; i += 2) {
+            std::string arg = argv[i];
+            uint64_t value = 0;
+            bool ok = false;
+            if (i + 1 >= argc) {
+                ok = false;
+            } else if (arg == "--max-file-mb") {
+                if ((ok = parseLimit(argv[i + 1], UINT64_MAX >> 20, value))) fileBytes = value << 20;
+            } else if (arg == "--max-total-mb") {
+                if ((ok = parseLimit(argv[i + 1], UINT64_MAX >> 20, value))) totalBytes = value << 20;
+            } else if (arg == "--max-age-hours") {
+                if ((ok = parseLimit(argv[i + 1], SOAK_AGE_LIMIT_HOURS, value))) maxAge = std::chrono::hours(value);
+            }
+            if (!ok) {
+                std::cerr << "Invalid option " << arg << (i + 1 < argc ? std::string(" ") + argv[i + 1] : std::string()) << "\n"
+                          << "Usage: ./latency_measurer --soak DIR [--max-file-mb N] [--max-total-mb N] [--max-age-hours N]"
+                          << " (N a whole number >= 1)\n";
+                return 1;
+            }
+        }
+        return runSoak(argv[2], fileBytes, totalBytes, maxAge);
+    }
+
     std::ofstream resfile("log.txt", std::ios::app);
     if (!resfile) {
         std::cerr << "Failed to open log file\n";
@@ -45,6 +635,10 @@ int main() {
     setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
     fcntl(sockfd, F_SETFL, O_NONBLOCK);
 
+    // Kernel receive timestamps keep user-space scheduling delay out of the intervals
+    int enable = 1;
+    bool kernelTimestamps = setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) == 0;
+
     sockaddr_in addr{};
     addr.sin_family      = AF_INET;
     addr.sin_addr.s_addr = INADDR_ANY;
@@ -57,45 +651,59 @@ int main() {
     }
 
     char buffer[4096];
+    char control[CMSG_SPACE(sizeof(timespec))];
     sockaddr_in sender{};
-    socklen_t senderLen = sizeof(sender);
 
     bool havePrev = false;
-    clock::time_point prev;
+    double prev = 0;
 
     std::vector<double> intervals;
+    JitterAnalyzer analyzer;
 
     auto start = clock::now();
 
-    std::cout << "Running for 8 minutes... listening for FF07 packets.\n";
+    std::cout << "Running for 8 minutes... listening for FF07 packets ("
+              << (kernelTimestamps ? "kernel" : "user-space") << " timestamps).\n";
 
     while (true) {
         auto now = clock::now();
         if (now - start >= RUN_DURATION) break;
 
-        ssize_t received = recvfrom(
-            sockfd, buffer, sizeof(buffer),
-            0, (sockaddr*)&sender, &senderLen
-        );
+        iovec iov{buffer, sizeof(buffer)};
+        msghdr msg{};
+        msg.msg_name = &sender;
+        msg.msg_namelen = sizeof(sender);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t received = recvmsg(sockfd, &msg, 0);
 
         if (received > 0) {
 
             if (containsFF07(buffer, received)) {
-                auto ts = clock::now();
+                // Arrival time in seconds: kernel timestamp when present, otherwise now
+                double ts = std::chrono::duration<double>(clock::now().time_since_epoch()).count();
+                for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+                    if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+                        timespec kts;
+                        std::memcpy(&kts, CMSG_DATA(c), sizeof(kts));
+                        ts = kts.tv_sec + kts.tv_nsec * 1e-9;
+                    }
+                }
 
                 // Timestamp in ms for the log
-                long long ms =
-                    std::chrono::duration_cast<std::chrono::milliseconds>(
-                        ts.time_since_epoch()
-                    ).count();
+                long long ms = (long long)(ts * 1e3);
 
                 if (havePrev) {
-                    double dt = std::chrono::duration<double>(ts - prev).count();
+                    double dt = ts - prev;
 
                     std::cout << "FF07 interval: " << dt << " sec\n";
                     resfile << ms << " ms, " << dt << " sec\n";
 
                     intervals.push_back(dt);
+                    analyzer.add(dt);
                 }
 
                 prev = ts;
@@ -105,7 +713,7 @@ int main() {
         else if (received < 0 &&
                  errno != EWOULDBLOCK &&
                  errno != EAGAIN) {
-            perror("recvfrom");
+            perror("recvmsg");
             break;
         }
     }
@@ -122,6 +730,7 @@ int main() {
         std::cout << "Number of FF07 packets detected: "
                   << (intervals.size() + 1) << "\n";
         std::cout << "Mean FF07 interval: " << mean << " sec\n";
+        analyzer.report(std::cout);
     } else {
         std::cout << "No FF07 intervals recorded.\n";
     }
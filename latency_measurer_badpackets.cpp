@@ -13,7 +13,9 @@
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
 
 #ifndef SO_EE_TYPE_DGRAM
 #define SO_EE_TYPE_DGRAM 1
@@ -23,6 +25,18 @@
 #define SO_EE_CODE_CSUM 1
 #endif
 
+// Error-queue messages read per recvmmsg() call while draining
+constexpr unsigned ERRQUEUE_BATCH = 8;
+
+// Everything the kernel reported through the socket error queue
+struct ErrQueueStats {
+    int badChecksumDrops = 0;       // ICMP origin, UDP checksum failure
+    int icmpErrors = 0;             // Any other ICMP/ICMP6 error (port unreachable, ...)
+    int zerocopyCompletions = 0;    // SO_EE_ORIGIN_ZEROCOPY, counted per completed send
+    int drains = 0;                 // POLLERR wake-ups
+    int messages = 0;
+};
+
 
 
 bool containsFF07(const char* buf, ssize_t len) {
@@ -36,42 +50,76 @@ bool containsFF07(const char* buf, ssize_t len) {
     return false;
 }
 
-// Check error queue for kernel-dropped UDP packets and increment counter
-void checkUDPErrQueue(int sockfd, int& dropCounter) {
-    char buf[2048];
-    char control[1024];
-
-    struct iovec iov;
-    iov.iov_base = buf;
-    iov.iov_len = sizeof(buf);
-
-    struct msghdr msg;
-    std::memset(&msg, 0, sizeof(msg));
-    msg.msg_iov = &iov;
-    msg.msg_iovlen = 1;
-    msg.msg_control = control;
-    msg.msg_controllen = sizeof(control);
-
-    ssize_t n = recvmsg(sockfd, &msg, MSG_ERRQUEUE);
-    if (n < 0) return; // no error queued
+// Kernel receive timestamp of a datagram (SCM_TIMESTAMPING: ts[0] software, ts[2] hardware), 0 if none.
+// CLOCK_REALTIME, the same base as std::chrono::system_clock.
+long long receiveTimestampNs(struct msghdr* msg) {
+    for (struct cmsghdr* c = CMSG_FIRSTHDR(msg); c != nullptr; c = CMSG_NXTHDR(msg, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_TIMESTAMPING) continue;
+        struct timespec ts[3];
+        std::memcpy(ts, CMSG_DATA(c), sizeof(ts));
+        const struct timespec& t = (ts[2].tv_sec || ts[2].tv_nsec) ? ts[2] : ts[0];
+        return (long long)t.tv_sec * 1000000000LL + t.tv_nsec;
+    }
+    return 0;
+}
 
-    for (struct cmsghdr* c = CMSG_FIRSTHDR(&msg); c != nullptr; c = CMSG_NXTHDR(&msg, c)) {
-        if (c->cmsg_level == SOL_IP && c->cmsg_type == IP_RECVERR) {
-            struct sock_extended_err* e = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(c));
+// Drain the socket error queue after POLLERR, ERRQUEUE_BATCH messages per syscall,
+// and route every event into the stats. Only called when the kernel signalled an error.
+void drainUDPErrQueue(int sockfd, ErrQueueStats& stats) {
+    static char bufs[ERRQUEUE_BATCH][256];
+    static char controls[ERRQUEUE_BATCH][512];
+    struct iovec iovs[ERRQUEUE_BATCH];
+    struct mmsghdr msgs[ERRQUEUE_BATCH];
 
-            if (e->ee_origin == SO_EE_ORIGIN_ICMP &&
-                e->ee_type == SO_EE_TYPE_DGRAM &&
-                e->ee_code == SO_EE_CODE_CSUM) {
+    stats.drains++;
+    while (true) {
+        std::memset(msgs, 0, sizeof(msgs));
+        for (unsigned i = 0; i < ERRQUEUE_BATCH; i++) {
+            iovs[i].iov_base = bufs[i];
+            iovs[i].iov_len = sizeof(bufs[i]);
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_control = controls[i];
+            msgs[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+        }
 
-                std::cout << "🔥 Kernel dropped a UDP packet due to BAD CHECKSUM\n";
-                dropCounter++;
+        int n = recvmmsg(sockfd, msgs, ERRQUEUE_BATCH, MSG_ERRQUEUE | MSG_DONTWAIT, nullptr);
+        if (n <= 0) return; // queue empty
+
+        for (int m = 0; m < n; m++) {
+            stats.messages++;
+            struct msghdr* msg = &msgs[m].msg_hdr;
+            for (struct cmsghdr* c = CMSG_FIRSTHDR(msg); c != nullptr; c = CMSG_NXTHDR(msg, c)) {
+                if (!((c->cmsg_level == SOL_IP && c->cmsg_type == IP_RECVERR) ||
+                      (c->cmsg_level == SOL_IPV6 && c->cmsg_type == IPV6_RECVERR))) continue;
+
+                struct sock_extended_err* e = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(c));
+                switch (e->ee_origin) {
+                    case SO_EE_ORIGIN_ICMP:
+                    case SO_EE_ORIGIN_ICMP6:
+                        if (e->ee_type == SO_EE_TYPE_DGRAM && e->ee_code == SO_EE_CODE_CSUM) {
+                            std::cout << "🔥 Kernel dropped a UDP packet due to BAD CHECKSUM\n";
+                            stats.badChecksumDrops++;
+                        } else {
+                            stats.icmpErrors++;
+                        }
+                        break;
+                    case SO_EE_ORIGIN_ZEROCOPY:
+                        // ee_info..ee_data is the range of completed zerocopy sends
+                        stats.zerocopyCompletions += e->ee_data - e->ee_info + 1;
+                        break;
+                    default:
+                        break;
+                }
             }
         }
+        if (n < (int)ERRQUEUE_BATCH) return;
     }
 }
 
 int main() {
     using clock = std::chrono::steady_clock;
+    using wall_clock = std::chrono::system_clock;
 
     std::ofstream resfile("log.txt", std::ios::app);
     if (!resfile) {
@@ -96,6 +144,14 @@ int main() {
         return 1;
     }
 
+    // Kernel receive timestamps (hardware when the NIC stamps, software otherwise) time the FF07 intervals,
+    // so they do not include how late this loop got to the datagram
+    int tsFlags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE |
+                  SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+    if (setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPING, &tsFlags, sizeof(tsFlags)) < 0) {
+        perror("setsockopt SO_TIMESTAMPING (timing FF07 packets on arrival in user space)");
+    }
+
     int reuse = 1;
     setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
     fcntl(sockfd, F_SETFL, O_NONBLOCK);
@@ -112,14 +168,22 @@ int main() {
     }
 
     char buffer[4096];
+    char control[256];
     sockaddr_in sender{};
-    socklen_t senderLen = sizeof(sender);
+    struct iovec iov = {buffer, sizeof(buffer)};
+    struct msghdr msg{};
 
     bool havePrev = false;
-    clock::time_point prev;
+    long long prevNs = 0;
+    long long kernelStamps = 0, userStamps = 0;
 
     std::vector<double> intervals;
-    int droppedPackets = 0;
+    ErrQueueStats errStats;
+
+    // POLLERR is always reported by poll(); the error queue is only read when it is set
+    struct pollfd pfd;
+    pfd.fd = sockfd;
+    pfd.events = POLLIN;
 
     auto start = clock::now();
     std::cout << "Running for 8 minutes... listening for FF07 packets.\n";
@@ -128,38 +192,58 @@ int main() {
         auto now = clock::now();
         if (now - start >= RUN_DURATION) break;
 
-        ssize_t received = recvfrom(
-            sockfd, buffer, sizeof(buffer),
-            0, (sockaddr*)&sender, &senderLen
-        );
-
-        if (received > 0) {
-            if (containsFF07(buffer, received)) {
-                auto ts = clock::now();
-                long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                    ts.time_since_epoch()
-                ).count();
-
-                if (havePrev) {
-                    double dt = std::chrono::duration<double>(ts - prev).count();
-                    std::cout << "FF07 interval: " << dt << " sec\n";
-                    resfile << ms << " ms, " << dt << " sec\n";
-                    intervals.push_back(dt);
+        int remainingMs = (int)std::chrono::duration_cast<std::chrono::milliseconds>(RUN_DURATION - (now - start)).count();
+        int ready = poll(&pfd, 1, remainingMs);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            perror("poll");
+            break;
+        }
+        if (ready == 0) continue;
+
+        if (pfd.revents & POLLERR) {
+            drainUDPErrQueue(sockfd, errStats);
+        }
+        if (!(pfd.revents & POLLIN)) continue;
+
+        // One poll() per burst: read until the socket is empty
+        bool failed = false;
+        while (true) {
+            msg.msg_name = &sender;
+            msg.msg_namelen = sizeof(sender);
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            ssize_t received = recvmsg(sockfd, &msg, 0);
+            if (received < 0) {
+                if (errno == EINTR) continue;
+                if (errno != EWOULDBLOCK && errno != EAGAIN) {
+                    perror("recvmsg");
+                    failed = true;
                 }
+                break;
+            }
+            if (!containsFF07(buffer, received)) continue;
 
-                prev = ts;
-                havePrev = true;
+            long long tsNs = receiveTimestampNs(&msg);
+            if (tsNs != 0) kernelStamps++;
+            else {
+                tsNs = std::chrono::duration_cast<std::chrono::nanoseconds>(wall_clock::now().time_since_epoch()).count();
+                userStamps++;
             }
-        }
-        else if (received < 0 &&
-                 errno != EWOULDBLOCK &&
-                 errno != EAGAIN) {
-            perror("recvfrom");
-            break;
-        }
 
-        // Check error queue for kernel-dropped packets
-        checkUDPErrQueue(sockfd, droppedPackets);
+            if (havePrev) {
+                double dt = (tsNs - prevNs) / 1e9;
+                std::cout << "FF07 interval: " << dt << " sec\n";
+                resfile << tsNs / 1000000 << " ms, " << dt << " sec\n";
+                intervals.push_back(dt);
+            }
+
+            prevNs = tsNs;
+            havePrev = true;
+        }
+        if (failed) break;
     }
 
     close(sockfd);
@@ -175,7 +259,11 @@ int main() {
         std::cout << "No FF07 intervals recorded.\n";
     }
 
-    std::cout << "Kernel dropped UDP packets (bad checksum): " << droppedPackets << "\n";
+    std::cout << "Kernel dropped UDP packets (bad checksum): " << errStats.badChecksumDrops << "\n";
+    std::cout << "Other ICMP errors: " << errStats.icmpErrors << "\n";
+    std::cout << "FF07 packets timed by kernel stamp: " << kernelStamps << " (user-space fallback: " << userStamps << ")\n";
+    std::cout << "Zerocopy completions: " << errStats.zerocopyCompletions << "\n";
+    std::cout << "Error-queue drains: " << errStats.drains << " (" << errStats.messages << " messages)\n";
 
     return 0;
 }
@@ -8,6 +8,8 @@
 #include <unistd.h>
 #include "fcntl.h"
 #include <chrono>
+#include <sys/socket.h>
+#include <linux/sock_diag.h>
 
 // Define the number of packets to stack before parsing
 constexpr int PACKETS_TO_STACK = 3; 
@@ -15,6 +17,17 @@ constexpr int PACKETS_TO_STACK = 3;
 constexpr size_t CHECKSUM_SIZE = 1;
 // Maximum expected packet size including data and checksum
 constexpr size_t MAX_PACKET_SIZE = 2048; 
+// Receive buffer bounds (bytes as reported by the kernel, i.e. already doubled)
+constexpr int RCVBUF_MIN = 256 * 1024;
+constexpr int RCVBUF_MAX = 64 * 1024 * 1024;
+constexpr int RCVBUF_INITIAL = 4 * 1024 * 1024;
+// Keep the buffer at HEADROOM x the deepest queue seen
+constexpr int RCVBUF_HEADROOM = 4;
+// Queue depth is sampled every N received packets, the buffer re-evaluated every interval
+constexpr long RCVBUF_SAMPLE_PACKETS = 32;
+constexpr auto RCVBUF_ADJUST_INTERVAL = std::chrono::seconds(2);
+// Shrinking only happens after this many quiet intervals in a row
+constexpr int RCVBUF_SHRINK_AFTER = 15;
 
 // --- 1. Utility for Little Endian to Host Conversion (Unchanged) ---
 
@@ -231,19 +244,115 @@ void process_packet_stack(const std::vector<unsigned char>& data, int total_pack
     std::cout << "========================================================" << std::endl;
 }
 
-// --- 5. Main Program Loop (UDP Listening, Checksum, and Stacking) ---
+// --- 5. Adaptive Receive Buffer ---
+
+/**
+ * @brief Sizes SO_RCVBUF from the measured burst depth instead of a fixed 64 MB.
+ * The queued bytes (SK_MEMINFO_RMEM_ALLOC, which includes skb overhead and is what the kernel
+ * compares against the limit) are sampled with SO_MEMINFO; SIOCINQ only reports the next
+ * datagram on UDP sockets, so it cannot see a burst.
+ */
+struct RcvBufTuner {
+    int effective = 0;         // Current SO_RCVBUF as read back from the kernel
+    uint32_t window_peak = 0;  // Deepest queue since the last adjustment
+    uint32_t drops = 0;        // SK_MEMINFO_DROPS: datagrams dropped because the buffer was full
+    int ceiling = 0;           // Largest size the kernel granted once a request was capped (0 = unknown)
+    int quiet_intervals = 0;
+    bool limit_reported = false;
+    std::chrono::steady_clock::time_point last_adjust = std::chrono::steady_clock::now();
+
+    /**
+     * @brief Requests `bytes` (kernel-doubled size) and reads back what was actually applied.
+     * Falls back to SO_RCVBUFFORCE (needs CAP_NET_ADMIN) when net.core.rmem_max caps the request.
+     */
+    void apply(int sockfd, int bytes) {
+        int request = bytes / 2; // The kernel doubles the value for bookkeeping overhead
+        setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &request, sizeof(request));
+        read_back(sockfd);
+        if (effective < bytes) {
+            setsockopt(sockfd, SOL_SOCKET, SO_RCVBUFFORCE, &request, sizeof(request));
+            read_back(sockfd);
+        }
+        if (effective < bytes) ceiling = effective;
+        if (effective < bytes && !limit_reported) {
+            std::cerr << "[WARNING] SO_RCVBUF capped at " << effective / 1024 << " KB (wanted " << bytes / 1024
+                      << " KB). Raise net.core.rmem_max or grant CAP_NET_ADMIN." << std::endl;
+            limit_reported = true;
+        }
+    }
+
+    void read_back(int sockfd) {
+        socklen_t len = sizeof(effective);
+        getsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &effective, &len);
+    }
+
+    void sample(int sockfd) {
+        uint32_t meminfo[SK_MEMINFO_VARS] = {};
+        socklen_t len = sizeof(meminfo);
+        if (getsockopt(sockfd, SOL_SOCKET, SO_MEMINFO, meminfo, &len) < 0) return;
+        window_peak = std::max(window_peak, meminfo[SK_MEMINFO_RMEM_ALLOC]);
+        uint32_t new_drops = meminfo[SK_MEMINFO_DROPS] - drops;
+        drops = meminfo[SK_MEMINFO_DROPS];
+        if (new_drops > 0) grow_after_drops(sockfd, new_drops);
+    }
+
+    /**
+     * @brief The buffer already overflowed: double it now instead of waiting for the next interval.
+     */
+    void grow_after_drops(int sockfd, uint32_t new_drops) {
+        long wanted = std::min<long>((long)effective * 2, ceiling ? ceiling : RCVBUF_MAX);
+        if (wanted <= effective) return;
+        int before = effective;
+        apply(sockfd, (int)wanted);
+        last_adjust = std::chrono::steady_clock::now();
+        quiet_intervals = 0;
+        if (effective != before) {
+            std::cout << "[INFO] SO_RCVBUF grown from " << before / 1024 << " KB to " << effective / 1024
+                      << " KB after " << new_drops << " kernel drops" << std::endl;
+        }
+    }
+
+    /**
+     * @brief Grows at once when the headroom is gone, shrinks only after a long quiet period.
+     * Once the kernel cap is known, growing past it is not retried.
+     */
+    void maybe_adjust(int sockfd) {
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_adjust < RCVBUF_ADJUST_INTERVAL) return;
+        last_adjust = now;
+
+        long wanted = std::clamp<long>((long)window_peak * RCVBUF_HEADROOM, RCVBUF_MIN, RCVBUF_MAX);
+        if (ceiling) wanted = std::min<long>(wanted, ceiling);
+        window_peak = 0;
+
+        bool grow = wanted > effective;
+        quiet_intervals = wanted < effective / 2 ? quiet_intervals + 1 : 0;
+        bool shrink = quiet_intervals >= RCVBUF_SHRINK_AFTER;
+        if (!grow && !shrink) return;
+
+        int before = effective;
+        apply(sockfd, (int)wanted);
+        quiet_intervals = 0;
+        if (effective != before) {
+            std::cout << "[INFO] SO_RCVBUF " << (grow ? "grown" : "shrunk") << " from " << before / 1024
+                      << " KB to " << effective / 1024 << " KB (" << drops << " kernel drops so far)" << std::endl;
+        }
+    }
+};
+
+// --- 6. Main Program Loop (UDP Listening, Checksum, and Stacking) ---
 
 int main() {
     using clock = std::chrono::high_resolution_clock;
     const int PORT = 1217;
     
-    // 5.1. Setup Socket
+    // 6.1. Setup Socket
     int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
     if (sockfd < 0) { std::cerr << "Error: Could not create socket." << std::endl; return 1; }
     int reuse = 1;
     setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
-    int rcvbuf = 64 * 1024 * 1024;
-    setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    RcvBufTuner rcvbuf;
+    rcvbuf.apply(sockfd, RCVBUF_INITIAL);
     sockaddr_in addr{};
     addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = INADDR_ANY;
@@ -256,7 +365,7 @@ int main() {
     std::cout << "Listening for UDP packets on port " << PORT 
               << ". Will stack " << PACKETS_TO_STACK << " *verified* packets before parsing." << std::endl;
     
-    // 5.2. Listening, Checksum, and Stacking Loop
+    // 6.2. Listening, Checksum, and Stacking Loop
     
     std::vector<unsigned char> current_packet_stack;
     int packets_in_stack = 0;
@@ -276,11 +385,15 @@ int main() {
 
         if (received_bytes > 0) {
             packetCounter++;
+            if (packetCounter % RCVBUF_SAMPLE_PACKETS == 0) {
+                rcvbuf.sample(sockfd);
+                rcvbuf.maybe_adjust(sockfd);
+            }
 
-            // --- 5.2.1. Checksum Verification (XOR Sum) ---
+            // --- 6.2.1. Checksum Verification (XOR Sum) ---
             if (verify_checksum((unsigned char*)packet_buffer, received_bytes)) {
                 
-                // --- 5.2.2. Stack the verified packet data ---
+                // --- 6.2.2. Stack the verified packet data ---
                 current_packet_stack.insert(
                     current_packet_stack.end(),
                     (unsigned char*)packet_buffer, 
@@ -288,7 +401,7 @@ int main() {
                 );
                 packets_in_stack++;
 
-                // --- 5.2.3. Check if stacking limit is reached ---
+                // --- 6.2.3. Check if stacking limit is reached ---
                 if (packets_in_stack >= PACKETS_TO_STACK) {
                     process_packet_stack(current_packet_stack, packets_in_stack);
                     
@@ -300,14 +413,15 @@ int main() {
                 droppedCounter++;
             }
 
-            // --- 5.2.4. Performance Monitoring ---
+            // --- 6.2.4. Performance Monitoring ---
             if (packetCounter % 500 == 0) {
                 auto now = clock::now();
                 auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time);
 
                 std::cout << "[INFO] Received a total of " << packetCounter
                           << " packets (" << droppedCounter << " dropped) in " 
-                          << elapsed.count() << " ms\n";
+                          << elapsed.count() << " ms | SO_RCVBUF " << rcvbuf.effective / 1024
+                          << " KB, " << rcvbuf.drops << " kernel drops\n";
 
                 start_time = clock::now();
             }
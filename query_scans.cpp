@@ -0,0 +1,618 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <cerrno>
+#include <cstdlib>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// Query tool over the recorded packet captures (./packets/*.bin).
+// Example:
+//   ./query_scans --from-ms 3327600 --to-ms 3330000 --beams 100:400 --max-dist 500 --mode min
+// Modes: scans (matching scans), count (matching beams), min (min distance per beam), hist (distance histogram)
+// The chunk index is built from the preamble and data output header of each datagram only; scans are
+// read and decoded only for the chunks that survive pruning. Distance statistics need a decode, so each
+// query records them for the chunks it decoded in CHUNK_CACHE_FILE (in the recordings folder), and later
+// queries prune on them too.
+
+// Number of decoded scans summarised by one chunk entry of the index
+constexpr size_t CHUNK_SCANS = 32;
+// Width of one histogram bucket in mm
+constexpr uint16_t HIST_BUCKET_MM = 250;
+constexpr size_t HIST_BUCKETS = 32;
+// MS3 UDP preamble in front of every fragment ("MS3 MD" + version + lengths)
+constexpr size_t MS3_PREAMBLE_SIZE = 24;
+// Per-chunk distance statistics, valid while the recordings (file count, bytes, newest mtime) are unchanged
+constexpr const char* CHUNK_CACHE_FILE = ".chunk_index";
+constexpr uint32_t CHUNK_CACHE_MAGIC = 0x58444943;  // "CIDX"
+constexpr uint32_t CHUNK_CACHE_VERSION = 1;
+// Upper bound accepted for --threads
+constexpr uint64_t MAX_THREADS = 1024;
+
+// --- 1. Utility for Little Endian to Host Conversion ---
+
+inline uint32_t le_to_h_u32(uint32_t value) {
+    #if __BYTE_ORDER == __LITTLE_ENDIAN || defined(__LITTLE_ENDIAN__)
+        return value;
+    #else
+        return (value >> 24) | ((value << 8) & 0x00FF0000) | ((value >> 8) & 0x0000FF00) | (value << 24);
+    #endif
+}
+
+inline uint16_t le_to_h_u16(uint16_t value) {
+    #if __BYTE_ORDER == __LITTLE_ENDIAN || defined(__LITTLE_ENDIAN__)
+        return value;
+    #else
+        return (value >> 8) | (value << 8);
+    #endif
+}
+
+// --- 2. Data Structure Definitions (Packed) ---
+#pragma pack(push, 1)
+
+struct MS3_Preamble {
+    char magic[6];              // "MS3 MD"
+    uint16_t version;           // Offset 6
+    uint32_t total_length;      // Offset 8  | Length of the reassembled scan
+    uint32_t identification;    // Offset 12 | Same for all fragments of one scan
+    uint32_t fragment_offset;   // Offset 16 | Position of the payload in the scan
+    uint32_t reserved;          // Offset 20
+}; // Total size: 24 bytes
+
+struct SICK_DataOutput_Header {
+    uint8_t version[4];         // 4 bytes | Struct Offset 0
+    uint32_t device_sn;         // 4 bytes | Struct Offset 4
+    uint32_t system_plug_sn;    // 4 bytes | Struct Offset 8
+    uint8_t channel_num;        // 1 byte  | Struct Offset 12
+    uint8_t reserved_1[3];      // 3 bytes | Struct Offset 13
+    uint32_t sequence_num;      // 4 bytes | Struct Offset 16
+    uint32_t scan_num;          // 4 bytes | Struct Offset 20 <--- Scan ID
+    uint16_t timestamp_date;    // 2 bytes | Struct Offset 24 (days since 1972-01-01)
+    uint16_t reserved_2;        // 2 bytes | Struct Offset 26
+    uint32_t timestamp_time;    // 4 bytes | Struct Offset 28 (ms since midnight)
+    uint16_t block_offset_size[10]; // Struct Offset 32: (offset, size) for the 5 data blocks
+    uint8_t remaining_header[60 - 52];
+}; // Total size: 60 bytes
+
+struct ChunkCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t files;
+    uint64_t bytes;
+    int64_t newest_mtime;
+    uint64_t scans;
+    uint64_t chunk_scans;
+};
+
+struct ChunkCacheEntry {
+    uint8_t known;
+    uint16_t d_min;
+    uint16_t d_max;
+};
+
+#pragma pack(pop)
+
+// Block order inside SICK_DataOutput_Header::block_offset_size
+enum DataBlock { GENERAL_SYSTEM_STATE = 0, DERIVED_VALUES, MEASUREMENT_DATA, INTRUSION_DATA, APPLICATION_DATA };
+
+struct Scan {
+    uint32_t device_sn;
+    uint8_t channel_num;
+    uint32_t scan_num;
+    uint64_t time_ms;              // date * 86400000 + time of day
+    std::vector<uint16_t> distance; // One entry per beam (mm)
+};
+
+// One datagram file of an indexed scan
+struct FragmentRef {
+    uint32_t file;                  // Index into Recordings::files
+    uint32_t offset;                // Position of the payload in the scan
+    uint32_t length;
+};
+
+// A complete scan found in the recordings: header fields only, the payload stays on disk
+struct ScanRef {
+    uint32_t device_sn = 0;
+    uint8_t channel_num = 0;
+    uint32_t scan_num = 0;
+    uint64_t time_ms = 0;
+    size_t total = 0;
+    size_t max_beams = 0;           // Upper bound from the measurement block size
+    std::vector<FragmentRef> fragments;
+};
+
+struct Recordings {
+    std::vector<fs::path> files;
+    std::vector<ScanRef> scans;     // Time order
+    uint64_t bytes = 0;
+    int64_t newest_mtime = INT64_MIN;  // file_time_type ticks, negative with libstdc++'s clock epoch
+};
+
+struct ChunkStats {
+    size_t first_scan;
+    size_t scan_count;
+    uint64_t t_min, t_max;
+    bool distances_known;           // d_min/d_max come from a decode (this query or the chunk cache)
+    uint16_t d_min, d_max;          // Over all beams of all scans in the chunk
+    size_t max_beams;
+    std::vector<uint32_t> sensors;  // Sorted distinct device serial numbers
+};
+
+struct Query {
+    uint64_t from_ms = 0;
+    uint64_t to_ms = UINT64_MAX;
+    bool has_sensor = false;
+    uint32_t sensor = 0;
+    size_t beam_first = 0;
+    size_t beam_last = SIZE_MAX;    // Exclusive
+    uint16_t min_dist = 1;          // 0 mm means "no echo", skipped by default
+    uint16_t max_dist = 0xFFFF;
+    std::string mode = "count";
+    unsigned threads = 0;
+    std::string folder = "./packets";
+};
+
+struct QueryResult {
+    uint64_t matching_beams = 0;
+    uint64_t scans_decoded = 0;
+    uint64_t scans_scanned = 0;
+    std::vector<uint16_t> min_per_beam;
+    uint64_t histogram[HIST_BUCKETS] = {};
+    std::vector<std::pair<size_t, size_t>> matching_scans; // (scan index, beams matched)
+};
+
+// --- 3. Indexing and Loading the Recordings ---
+
+/**
+ * @brief Decodes one reassembled scan (data output header + measurement block).
+ * @return false if the block directory points outside the buffer.
+ */
+bool decode_scan(const std::vector<unsigned char>& data, Scan& scan) {
+    if (data.size() < sizeof(SICK_DataOutput_Header)) return false;
+
+    SICK_DataOutput_Header header;
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    size_t offset = le_to_h_u16(header.block_offset_size[2 * MEASUREMENT_DATA]);
+    size_t size = le_to_h_u16(header.block_offset_size[2 * MEASUREMENT_DATA + 1]);
+    if (size < 4 || offset + size > data.size()) return false;
+
+    uint32_t beams;
+    std::memcpy(&beams, data.data() + offset, 4);
+    beams = le_to_h_u32(beams);
+    if (4 + (size_t)beams * 4 > size) return false;
+
+    scan.device_sn = le_to_h_u32(header.device_sn);
+    scan.channel_num = header.channel_num;
+    scan.scan_num = le_to_h_u32(header.scan_num);
+    scan.time_ms = (uint64_t)le_to_h_u16(header.timestamp_date) * 86400000ULL + le_to_h_u32(header.timestamp_time);
+    scan.distance.resize(beams);
+
+    // Each beam: distance (2 bytes), reflectivity (1 byte), status (1 byte)
+    const unsigned char* beam_ptr = data.data() + offset + 4;
+    for (uint32_t i = 0; i < beams; i++) {
+        uint16_t d;
+        std::memcpy(&d, beam_ptr + i * 4, 2);
+        scan.distance[i] = le_to_h_u16(d);
+    }
+    return true;
+}
+
+/**
+ * @brief Takes the header fields of a scan from its first fragment.
+ * @return false if the measurement block lies outside the scan (decode_scan would reject it).
+ */
+bool read_scan_header(const unsigned char* bytes, size_t total, ScanRef& scan) {
+    if (total < sizeof(SICK_DataOutput_Header)) return false;
+    SICK_DataOutput_Header header;
+    std::memcpy(&header, bytes, sizeof(header));
+
+    size_t offset = le_to_h_u16(header.block_offset_size[2 * MEASUREMENT_DATA]);
+    size_t size = le_to_h_u16(header.block_offset_size[2 * MEASUREMENT_DATA + 1]);
+    if (size < 4 || offset + size > total) return false;
+
+    scan.device_sn = le_to_h_u32(header.device_sn);
+    scan.channel_num = header.channel_num;
+    scan.scan_num = le_to_h_u32(header.scan_num);
+    scan.time_ms = (uint64_t)le_to_h_u16(header.timestamp_date) * 86400000ULL + le_to_h_u32(header.timestamp_time);
+    scan.max_beams = (size - 4) / 4;
+    return true;
+}
+
+/**
+ * @brief Indexes every .bin datagram in the folder (in file name order) into complete scans.
+ * Only the preamble and, for first fragments, the data output header are read.
+ */
+Recordings index_recordings(const std::string& folder) {
+    Recordings rec;
+    for (const auto& entry : fs::directory_iterator(folder)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".bin") {
+            rec.files.push_back(entry.path());
+        }
+    }
+    std::sort(rec.files.begin(), rec.files.end());
+
+    struct Pending { ScanRef scan; size_t received = 0; bool header_ok = false; };
+    std::map<uint32_t, Pending> in_flight;
+    unsigned char head[MS3_PREAMBLE_SIZE + sizeof(SICK_DataOutput_Header)];
+
+    for (uint32_t f = 0; f < rec.files.size(); f++) {
+        std::error_code ec;
+        uint64_t size = fs::file_size(rec.files[f], ec);
+        if (ec) continue;
+        rec.bytes += size;
+        auto mtime = fs::last_write_time(rec.files[f], ec);
+        if (!ec) rec.newest_mtime = std::max<int64_t>(rec.newest_mtime, mtime.time_since_epoch().count());
+        if (size <= MS3_PREAMBLE_SIZE) continue;
+
+        std::ifstream file(rec.files[f], std::ios::binary);
+        file.read((char*)head, sizeof(head));
+        size_t got = file.gcount();
+        if (got < MS3_PREAMBLE_SIZE || std::memcmp(head, "MS3 MD", 6) != 0) continue;
+
+        MS3_Preamble pre;
+        std::memcpy(&pre, head, sizeof(pre));
+        size_t total = le_to_h_u32(pre.total_length);
+        size_t frag_offset = le_to_h_u32(pre.fragment_offset);
+        size_t frag_len = size - MS3_PREAMBLE_SIZE;
+        if (frag_offset + frag_len > total) continue;
+
+        uint32_t id = le_to_h_u32(pre.identification);
+        Pending& p = in_flight[id];
+        p.scan.total = total;
+        p.scan.fragments.push_back({f, (uint32_t)frag_offset, (uint32_t)frag_len});
+        p.received += frag_len;
+        if (frag_offset == 0 && got == sizeof(head)) {
+            p.header_ok = read_scan_header(head + MS3_PREAMBLE_SIZE, total, p.scan);
+        }
+
+        if (p.received >= total) {
+            if (p.header_ok) rec.scans.push_back(std::move(p.scan));
+            in_flight.erase(id);
+        }
+    }
+
+    std::stable_sort(rec.scans.begin(), rec.scans.end(), [](const ScanRef& a, const ScanRef& b) { return a.time_ms < b.time_ms; });
+    return rec;
+}
+
+/**
+ * @brief Reads the fragments of one indexed scan from disk and decodes it.
+ */
+bool load_scan(const Recordings& rec, const ScanRef& ref, std::vector<unsigned char>& buffer, Scan& scan) {
+    buffer.assign(ref.total, 0);
+    for (const FragmentRef& f : ref.fragments) {
+        if ((size_t)f.offset + f.length > ref.total) return false;
+        std::ifstream file(rec.files[f.file], std::ios::binary);
+        file.seekg(MS3_PREAMBLE_SIZE);
+        if (!file.read((char*)buffer.data() + f.offset, f.length)) return false;
+    }
+    return decode_scan(buffer, scan);
+}
+
+// --- 4. Chunk Index (Statistics for Pruning) ---
+
+std::vector<ChunkStats> build_chunk_index(const std::vector<ScanRef>& scans) {
+    std::vector<ChunkStats> chunks;
+    for (size_t first = 0; first < scans.size(); first += CHUNK_SCANS) {
+        ChunkStats c{first, std::min(CHUNK_SCANS, scans.size() - first), UINT64_MAX, 0, false, 0xFFFF, 0, 0, {}};
+        for (size_t i = first; i < first + c.scan_count; i++) {
+            const ScanRef& s = scans[i];
+            c.t_min = std::min(c.t_min, s.time_ms);
+            c.t_max = std::max(c.t_max, s.time_ms);
+            c.max_beams = std::max(c.max_beams, s.max_beams);
+            c.sensors.push_back(s.device_sn);
+        }
+        std::sort(c.sensors.begin(), c.sensors.end());
+        c.sensors.erase(std::unique(c.sensors.begin(), c.sensors.end()), c.sensors.end());
+        chunks.push_back(std::move(c));
+    }
+    return chunks;
+}
+
+ChunkCacheHeader chunk_cache_header(const Recordings& rec) {
+    return {CHUNK_CACHE_MAGIC, CHUNK_CACHE_VERSION, rec.files.size(), rec.bytes, rec.newest_mtime,
+            rec.scans.size(), CHUNK_SCANS};
+}
+
+/**
+ * @brief Fills in the distance statistics recorded by earlier queries, if the recordings are unchanged.
+ */
+void load_chunk_cache(const std::string& folder, const Recordings& rec, std::vector<ChunkStats>& chunks) {
+    std::ifstream file(fs::path(folder) / CHUNK_CACHE_FILE, std::ios::binary);
+    ChunkCacheHeader header, expected = chunk_cache_header(rec);
+    if (!file.read((char*)&header, sizeof(header)) || std::memcmp(&header, &expected, sizeof(header)) != 0) return;
+    for (ChunkStats& c : chunks) {
+        ChunkCacheEntry e;
+        if (!file.read((char*)&e, sizeof(e))) return;
+        if (!e.known) continue;
+        c.distances_known = true;
+        c.d_min = e.d_min;
+        c.d_max = e.d_max;
+    }
+}
+
+void save_chunk_cache(const std::string& folder, const Recordings& rec, const std::vector<ChunkStats>& chunks) {
+    fs::path path = fs::path(folder) / CHUNK_CACHE_FILE;
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    ChunkCacheHeader header = chunk_cache_header(rec);
+    file.write((const char*)&header, sizeof(header));
+    for (const ChunkStats& c : chunks) {
+        ChunkCacheEntry e{(uint8_t)c.distances_known, c.d_min, c.d_max};
+        file.write((const char*)&e, sizeof(e));
+    }
+    if (!file) std::cerr << "[WARNING] Could not write " << path << "; distance statistics are not kept." << std::endl;
+}
+
+/**
+ * @brief Returns the chunks that may contain matches.
+ * Distance pruning only applies to chunks whose statistics are known.
+ * Chunks are in time order, so the time range is resolved with a binary search first.
+ */
+std::vector<size_t> prune_chunks(const std::vector<ChunkStats>& chunks, const Query& q) {
+    auto first = std::lower_bound(chunks.begin(), chunks.end(), q.from_ms,
+                                  [](const ChunkStats& c, uint64_t t) { return c.t_max < t; });
+    std::vector<size_t> selected;
+    for (auto it = first; it != chunks.end() && it->t_min <= q.to_ms; ++it) {
+        if (q.has_sensor && !std::binary_search(it->sensors.begin(), it->sensors.end(), q.sensor)) continue;
+        if (it->distances_known && (it->d_max < q.min_dist || it->d_min > q.max_dist)) continue;
+        if (q.beam_first >= it->max_beams) continue;
+        selected.push_back(it - chunks.begin());
+    }
+    return selected;
+}
+
+// --- 5. Predicate Evaluation (SIMD) ---
+
+/**
+ * @brief Evaluates min_dist <= d <= max_dist over beams [first, last) of one scan.
+ * Updates the per-beam minimum of matching beams and the histogram.
+ * @return Number of matching beams.
+ */
+size_t evaluate_scan(const uint16_t* d, size_t first, size_t last, uint16_t lo, uint16_t hi,
+                     uint16_t* min_per_beam, uint64_t* histogram) {
+    size_t matches = 0;
+    size_t i = first;
+
+#if defined(__SSE2__)
+    // SSE2 only has signed 16-bit compares: flip the sign bit so unsigned order is preserved.
+    const __m128i bias = _mm_set1_epi16((short)0x8000);
+    const __m128i lo_v = _mm_xor_si128(_mm_set1_epi16((short)lo), bias);
+    const __m128i hi_v = _mm_xor_si128(_mm_set1_epi16((short)hi), bias);
+    for (; i + 8 <= last; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(d + i));
+        __m128i vs = _mm_xor_si128(v, bias);
+        __m128i outside = _mm_or_si128(_mm_cmplt_epi16(vs, lo_v), _mm_cmpgt_epi16(vs, hi_v));
+        unsigned mask = ~_mm_movemask_epi8(outside) & 0xFFFF;
+        if (mask == 0) continue;
+
+        // Non-matching lanes become 0xFFFF so they never lower the per-beam minimum
+        __m128i candidate = _mm_xor_si128(_mm_or_si128(v, outside), bias);
+        __m128i current = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(min_per_beam + i)), bias);
+        _mm_storeu_si128((__m128i*)(min_per_beam + i), _mm_xor_si128(_mm_min_epi16(candidate, current), bias));
+
+        matches += __builtin_popcount(mask) / 2;
+        for (unsigned lanes = mask; lanes; lanes &= lanes - 1) {
+            unsigned lane = __builtin_ctz(lanes) / 2;
+            lanes &= lanes - 1; // Each lane owns two mask bits
+            histogram[std::min<size_t>(d[i + lane] / HIST_BUCKET_MM, HIST_BUCKETS - 1)]++;
+        }
+    }
+#endif
+
+    for (; i < last; i++) {
+        if (d[i] < lo || d[i] > hi) continue;
+        matches++;
+        min_per_beam[i] = std::min(min_per_beam[i], d[i]);
+        histogram[std::min<size_t>(d[i] / HIST_BUCKET_MM, HIST_BUCKETS - 1)]++;
+    }
+    return matches;
+}
+
+// --- 6. Parallel Scan over the Selected Chunks ---
+
+/**
+ * @brief Decodes the selected chunks and evaluates the query over them. A chunk is always decoded
+ * as a whole (the unit of I/O), which also gives its distance statistics for later pruning.
+ */
+QueryResult run_query(const Recordings& rec, std::vector<ChunkStats>& chunks,
+                      const std::vector<size_t>& selected, const Query& q) {
+    size_t max_beams = 0;
+    for (size_t c : selected) max_beams = std::max(max_beams, chunks[c].max_beams);
+
+    QueryResult total;
+    total.min_per_beam.assign(max_beams, 0xFFFF);
+
+    unsigned workers = q.threads ? q.threads : std::max(1u, std::thread::hardware_concurrency());
+    workers = std::min<unsigned>(workers, std::max<size_t>(1, selected.size()));
+
+    std::atomic<size_t> next_chunk{0};
+    std::mutex merge_mutex;
+
+    auto worker = [&]() {
+        QueryResult local;
+        local.min_per_beam.assign(max_beams, 0xFFFF);
+        std::vector<Scan> loaded;
+        std::vector<unsigned char> buffer;
+
+        for (size_t k = next_chunk++; k < selected.size(); k = next_chunk++) {
+            ChunkStats& c = chunks[selected[k]];  // Each selected chunk is handled by one worker
+            loaded.resize(c.scan_count);
+            uint16_t d_min = 0xFFFF, d_max = 0;
+            for (size_t j = 0; j < c.scan_count; j++) {
+                Scan& s = loaded[j];
+                if (!load_scan(rec, rec.scans[c.first_scan + j], buffer, s)) {
+                    s.distance.clear();  // Never matches
+                    continue;
+                }
+                local.scans_decoded++;
+                for (uint16_t d : s.distance) {
+                    d_min = std::min(d_min, d);
+                    d_max = std::max(d_max, d);
+                }
+            }
+            c.d_min = d_min;
+            c.d_max = d_max;
+            c.distances_known = true;
+
+            for (size_t j = 0; j < c.scan_count; j++) {
+                const Scan& s = loaded[j];
+                size_t i = c.first_scan + j;
+                if (s.distance.empty()) continue;
+                if (s.time_ms < q.from_ms || s.time_ms > q.to_ms) continue;
+                if (q.has_sensor && s.device_sn != q.sensor) continue;
+
+                size_t last = std::min(q.beam_last, s.distance.size());
+                if (q.beam_first >= last) continue;
+
+                local.scans_scanned++;
+                size_t n = evaluate_scan(s.distance.data(), q.beam_first, last, q.min_dist, q.max_dist,
+                                         local.min_per_beam.data(), local.histogram);
+                local.matching_beams += n;
+                if (n > 0) local.matching_scans.emplace_back(i, n);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(merge_mutex);
+        total.matching_beams += local.matching_beams;
+        total.scans_decoded += local.scans_decoded;
+        total.scans_scanned += local.scans_scanned;
+        for (size_t b = 0; b < max_beams; b++) total.min_per_beam[b] = std::min(total.min_per_beam[b], local.min_per_beam[b]);
+        for (size_t h = 0; h < HIST_BUCKETS; h++) total.histogram[h] += local.histogram[h];
+        total.matching_scans.insert(total.matching_scans.end(), local.matching_scans.begin(), local.matching_scans.end());
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < workers; t++) pool.emplace_back(worker);
+    for (auto& t : pool) t.join();
+
+    std::sort(total.matching_scans.begin(), total.matching_scans.end());
+    return total;
+}
+
+// --- 7. Command Line and Output ---
+
+void print_usage() {
+    std::cerr << "Usage: ./query_scans [--from-ms T] [--to-ms T] [--sensor SN] [--beams FIRST:LAST]\n"
+              << "                     [--min-dist MM] [--max-dist MM] [--mode scans|count|min|hist]\n"
+              << "                     [--threads N] [--dir DIR]" << std::endl;
+}
+
+/**
+ * @brief Parses a whole decimal number from 0 to `max`; signs, trailing text and overflow are rejected.
+ */
+bool parse_number(const std::string& text, uint64_t max, uint64_t& value) {
+    if (text.empty() || !std::all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; })) return false;
+    errno = 0;
+    unsigned long long parsed = std::strtoull(text.c_str(), nullptr, 10);
+    if (errno == ERANGE || parsed > max) return false;
+    value = parsed;
+    return true;
+}
+
+bool parse_args(int argc, char** argv, Query& q) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Error: Missing value for " << arg << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        uint64_t n = 0, last = 0;
+        bool ok = true;
+        if (arg == "--from-ms") { ok = parse_number(value, UINT64_MAX, n); q.from_ms = n; }
+        else if (arg == "--to-ms") { ok = parse_number(value, UINT64_MAX, n); q.to_ms = n; }
+        else if (arg == "--sensor") { ok = parse_number(value, UINT32_MAX, n); q.has_sensor = true; q.sensor = (uint32_t)n; }
+        else if (arg == "--beams") {
+            size_t colon = value.find(':');
+            ok = colon != std::string::npos && parse_number(value.substr(0, colon), SIZE_MAX, n) &&
+                 parse_number(value.substr(colon + 1), SIZE_MAX, last) && n < last;
+            if (!ok) { std::cerr << "Error: --beams expects FIRST:LAST with FIRST < LAST" << std::endl; return false; }
+            q.beam_first = n;
+            q.beam_last = last;
+        }
+        else if (arg == "--min-dist") { ok = parse_number(value, 0xFFFF, n); q.min_dist = (uint16_t)n; }
+        else if (arg == "--max-dist") { ok = parse_number(value, 0xFFFF, n); q.max_dist = (uint16_t)n; }
+        else if (arg == "--mode") q.mode = value;
+        else if (arg == "--threads") { ok = parse_number(value, MAX_THREADS, n); q.threads = (unsigned)n; }
+        else if (arg == "--dir") q.folder = value;
+        else {
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            return false;
+        }
+        if (!ok) {
+            std::cerr << "Error: Invalid value '" << value << "' for " << arg << std::endl;
+            return false;
+        }
+    }
+    if (q.mode != "scans" && q.mode != "count" && q.mode != "min" && q.mode != "hist") {
+        std::cerr << "Error: --mode must be one of scans, count, min, hist" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    Query q;
+    if (!parse_args(argc, argv, q)) {
+        print_usage();
+        return 1;
+    }
+
+    if (!fs::exists(q.folder) || !fs::is_directory(q.folder)) {
+        std::cerr << "Error: Directory '" << q.folder << "' not found or is not a directory." << std::endl;
+        return 1;
+    }
+
+    Recordings rec = index_recordings(q.folder);
+    std::vector<ChunkStats> chunks = build_chunk_index(rec.scans);
+    load_chunk_cache(q.folder, rec, chunks);
+    size_t cached = std::count_if(chunks.begin(), chunks.end(), [](const ChunkStats& c) { return c.distances_known; });
+    std::vector<size_t> selected = prune_chunks(chunks, q);
+
+    std::cout << "[INFO] " << rec.scans.size() << " scans in " << chunks.size() << " chunks (" << cached
+              << " with distance statistics), " << selected.size() << " chunks left after pruning." << std::endl;
+
+    QueryResult r = run_query(rec, chunks, selected, q);
+    size_t known = std::count_if(chunks.begin(), chunks.end(), [](const ChunkStats& c) { return c.distances_known; });
+    if (known != cached) save_chunk_cache(q.folder, rec, chunks);
+
+    std::cout << "[INFO] Decoded " << r.scans_decoded << " scans, scanned " << r.scans_scanned << ", " << r.matching_beams
+              << " matching beams in " << r.matching_scans.size() << " scans." << std::endl;
+
+    if (q.mode == "scans") {
+        for (const auto& m : r.matching_scans) {
+            const ScanRef& s = rec.scans[m.first];
+            std::cout << "  Scan " << s.scan_num << " | Sensor " << s.device_sn << " ch " << (int)s.channel_num
+                      << " | t = " << s.time_ms << " ms | " << m.second << " beams matched" << std::endl;
+        }
+    } else if (q.mode == "min") {
+        for (size_t b = 0; b < r.min_per_beam.size(); b++) {
+            if (r.min_per_beam[b] == 0xFFFF) continue;
+            std::cout << "  Beam " << std::setw(4) << b << ": min distance " << std::setw(5) << r.min_per_beam[b] << " mm" << std::endl;
+        }
+    } else if (q.mode == "hist") {
+        for (size_t h = 0; h < HIST_BUCKETS; h++) {
+            if (r.histogram[h] == 0) continue;
+            std::cout << "  [" << std::setw(5) << h * HIST_BUCKET_MM << ", ";
+            if (h + 1 == HIST_BUCKETS) std::cout << "  inf) ";
+            else std::cout << std::setw(5) << (h + 1) * HIST_BUCKET_MM << ") ";
+            std::cout << std::setw(8) << r.histogram[h] << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,555 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <linux/filter.h>
+
+// Sharded receive with lock-free fan-in.
+// N receiver threads each own an SO_REUSEPORT socket on the same port (the kernel keeps one sender on
+// one socket, so each thread can reassemble on its own). Completed scans are passed as 32-bit handles
+// into a shared scan pool through a bounded Vyukov MPMC ring; the shared consumer threads dequeue in
+// batches. Free handles travel back through a second ring, so nothing on this path takes a mutex.
+// Receivers can be kept on the CPU where the kernel processed their packets (--steer):
+//   cpu  - each thread reads SO_INCOMING_CPU and pins itself there (follows RSS/RPS placement)
+//   bpf  - a reuseport CBPF program picks socket (softirq CPU % N) and receiver r is pinned to CPU r.
+//          Packets stay on the CPU that received them only when N equals the CPU count (the default
+//          for bpf); with fewer receivers, CPU c >= N lands on the receiver pinned to CPU c % N
+//   none - leave placement to the scheduler
+// Fan-out (--readers K): consumers publish each scan as the latest of its shard and K readers
+// (recorder, zones, publisher, tracker roles) sample it. A replaced scan's slot goes back to the pool
+// through epoch-based reclamation: readers only announce an epoch in their own cache line, no per-scan
+// refcount is touched, and the consumer's deferred free list releases slots no reader can still see.
+// Usage: ./reuseport_fanin [--receivers N] [--consumers M] [--steer cpu|bpf|none] [--readers K]
+
+constexpr int PORT = 1217;
+constexpr size_t MAX_PACKET_SIZE = 2048;
+constexpr size_t MS3_PREAMBLE_SIZE = 24;
+// Scan buffers shared by all threads; also the capacity of both rings (power of two)
+constexpr uint32_t POOL_SCANS = 256;
+constexpr size_t MAX_SCAN_SIZE = 65536;
+// Per receiver socket
+constexpr int RCVBUF_BYTES = 64 * 1024 * 1024;
+// Handles taken per consumer dequeue
+constexpr size_t DEQUEUE_BATCH = 16;
+// Drop incomplete scans once this many newer identifications have been seen
+constexpr uint32_t REASSEMBLY_WINDOW = 8;
+// SO_INCOMING_CPU is re-read every N datagrams; a move needs two consecutive agreeing reads
+constexpr long STEER_CHECK_PACKETS = 1024;
+// Fan-out readers; each needs an announcement slot
+constexpr int MAX_READERS = 16;
+// Retired slots a consumer collects before it scans the reader announcements
+constexpr size_t RECLAIM_BATCH = 8;
+
+// --- 1. Utility for Little Endian to Host Conversion ---
+
+inline uint32_t le_to_h_u32(uint32_t value) {
+    #if __BYTE_ORDER == __LITTLE_ENDIAN || defined(__LITTLE_ENDIAN__)
+        return value;
+    #else
+        return (value >> 24) | ((value << 8) & 0x00FF0000) | ((value >> 8) & 0x0000FF00) | (value << 24);
+    #endif
+}
+
+// --- 2. Data Structure Definitions (Packed) ---
+#pragma pack(push, 1)
+
+struct MS3_Preamble {
+    char magic[6];              // "MS3 MD"
+    uint16_t version;           // Offset 6
+    uint32_t total_length;      // Offset 8  | Length of the reassembled scan
+    uint32_t identification;    // Offset 12 | Same for all fragments of one scan
+    uint32_t fragment_offset;   // Offset 16 | Position of the payload in the scan
+    uint32_t reserved;          // Offset 20
+}; // Total size: 24 bytes
+
+#pragma pack(pop)
+
+// --- 3. Bounded MPMC Ring (Vyukov) ---
+
+/**
+ * @brief Bounded multi-producer multi-consumer queue of 32-bit handles.
+ * Each cell carries a sequence number: producers wait for seq == pos, consumers for seq == pos + 1.
+ * Capacity must be a power of two.
+ */
+template <uint32_t Capacity>
+class MpmcRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    MpmcRing() {
+        for (uint32_t i = 0; i < Capacity; i++) cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool try_push(uint32_t handle) {
+        uint64_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & (Capacity - 1)];
+            uint64_t seq = cell.sequence.load(std::memory_order_acquire);
+            int64_t diff = (int64_t)seq - (int64_t)pos;
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.handle = handle;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // Full
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Claims up to `max` consecutive ready cells with a single CAS.
+     * @return Number of handles written to `out`.
+     */
+    size_t try_pop_batch(uint32_t* out, size_t max) {
+        uint64_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            size_t ready = 0;
+            while (ready < max) {
+                const Cell& cell = cells[(pos + ready) & (Capacity - 1)];
+                if (cell.sequence.load(std::memory_order_acquire) != pos + ready + 1) break;
+                ready++;
+            }
+            if (ready == 0) {
+                uint64_t now = dequeue_pos.load(std::memory_order_relaxed);
+                if (now == pos) return 0; // Empty
+                pos = now;
+                continue;
+            }
+            if (dequeue_pos.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed)) {
+                for (size_t i = 0; i < ready; i++) {
+                    Cell& cell = cells[(pos + i) & (Capacity - 1)];
+                    out[i] = cell.handle;
+                    cell.sequence.store(pos + i + Capacity, std::memory_order_release);
+                }
+                return ready;
+            }
+        }
+    }
+
+    bool try_pop(uint32_t& handle) { return try_pop_batch(&handle, 1) == 1; }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<uint64_t> sequence;
+        uint32_t handle;
+    };
+    Cell cells[Capacity];
+    alignas(64) std::atomic<uint64_t> enqueue_pos{0};
+    alignas(64) std::atomic<uint64_t> dequeue_pos{0};
+};
+
+// --- 4. Scan Pool and Shared State ---
+
+struct ScanBuffer {
+    uint32_t length = 0;
+    uint32_t received = 0;
+    uint16_t receiver = 0;
+    std::vector<unsigned char> data;
+};
+
+std::vector<ScanBuffer> scan_pool(POOL_SCANS);
+MpmcRing<POOL_SCANS> free_handles;
+MpmcRing<POOL_SCANS> ready_handles;
+
+struct alignas(64) ThreadStats {
+    std::atomic<long> scans{0};
+    std::atomic<long> dropped{0};   // Pool exhausted or fragment lost (readers: scans skipped)
+    std::atomic<long> batches{0};
+    std::atomic<int> cpu{-1};       // CPU the receiver is pinned to
+    std::atomic<int> napi_id{0};    // NAPI instance (RX queue) of the last packet
+    std::atomic<long> deferred{0};  // Consumers: retired slots waiting for the readers
+};
+
+std::atomic<bool> running{true};
+
+enum class Steering { NONE, CPU, BPF };
+
+// --- 5. RX-Queue / CPU Steering ---
+
+/**
+ * @brief Requests `bytes` of receive buffer, retrying with SO_RCVBUFFORCE (CAP_NET_ADMIN) when
+ * net.core.rmem_max caps it. Same as dual_path_receiver.cpp.
+ * @return The granted size in request units; getsockopt reports twice that.
+ */
+int set_receive_buffer(int sockfd, int bytes) {
+    int granted = 0;
+    socklen_t len = sizeof(granted);
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+    getsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &granted, &len);
+    if (granted / 2 < bytes) {
+        setsockopt(sockfd, SOL_SOCKET, SO_RCVBUFFORCE, &bytes, sizeof(bytes));
+        getsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &granted, &len);
+    }
+    return granted / 2;
+}
+
+/**
+ * @brief Creates one SO_REUSEPORT socket bound to PORT. Sockets must be created in receiver order:
+ * the reuseport group index (used by the BPF program) follows bind order.
+ */
+int open_receiver_socket() {
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd < 0) return -1;
+    int reuse = 1;
+    setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse));
+    int granted = set_receive_buffer(sockfd, RCVBUF_BYTES);
+    static bool capped_reported = false;  // Once, not once per receiver
+    if (granted < RCVBUF_BYTES && !capped_reported) {
+        std::cerr << "[WARNING] Receive buffer is " << granted / 1024 << " KB, not " << RCVBUF_BYTES / 1024
+                  << " KB: raise net.core.rmem_max or grant CAP_NET_ADMIN." << std::endl;
+        capped_reported = true;
+    }
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(PORT);
+    if (bind(sockfd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(sockfd);
+        return -1;
+    }
+    timeval timeout{0, 100000};
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return sockfd;
+}
+
+/**
+ * @brief Attaches "return softirq_cpu % receivers" as the reuseport selector of the group.
+ * @return false if the kernel rejected the program (the group then falls back to hashing).
+ */
+bool attach_cpu_selector(int sockfd, int receivers) {
+    sock_filter code[] = {
+        { BPF_LD  | BPF_W | BPF_ABS, 0, 0, (uint32_t)(SKF_AD_OFF + SKF_AD_CPU) },
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0, (uint32_t)receivers },
+        { BPF_RET | BPF_A, 0, 0, 0 },
+    };
+    sock_fprog prog{ (unsigned short)(sizeof(code) / sizeof(code[0])), code };
+    return setsockopt(sockfd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) == 0;
+}
+
+bool pin_to_cpu(int cpu) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+/**
+ * @brief Follows the CPU the kernel delivered the last datagram on (Steering::CPU).
+ * Requiring two agreeing reads in a row keeps one-off RPS/IRQ moves from bouncing the thread.
+ */
+void follow_incoming_cpu(int sockfd, ThreadStats& stats, int& candidate) {
+    int cpu = -1;
+    socklen_t len = sizeof(cpu);
+    if (getsockopt(sockfd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) < 0 || cpu < 0) return;
+    int napi_id = 0;
+    len = sizeof(napi_id);
+    if (getsockopt(sockfd, SOL_SOCKET, SO_INCOMING_NAPI_ID, &napi_id, &len) == 0) stats.napi_id = napi_id;
+
+    if (cpu == stats.cpu) {
+        candidate = -1;
+    } else if (cpu == candidate || stats.cpu < 0) {
+        if (pin_to_cpu(cpu)) stats.cpu = cpu;
+        candidate = -1;
+    } else {
+        candidate = cpu;
+    }
+}
+
+// --- 6. Epoch-Based Reclamation of Published Scans ---
+
+// Latest scan of one receiver shard: (publish sequence << 32) | pool handle, 0 = nothing yet
+struct alignas(64) PublishedSlot {
+    std::atomic<uint64_t> current{0};
+};
+
+std::vector<PublishedSlot> published;
+
+/**
+ * @brief Readers announce the global epoch in their own slot before loading a published handle and
+ * clear it when done. A retired handle is tagged with the epoch current when it was unlinked; once every
+ * active reader announces a later epoch, none of them can still hold it and it returns to the pool.
+ */
+class EpochReclaimer {
+public:
+    int register_reader() { return next_reader++; }
+
+    class Guard {
+    public:
+        Guard(EpochReclaimer& domain, int reader) : epoch(domain.readers[reader].epoch) {
+            epoch.store(domain.global_epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+        ~Guard() { epoch.store(0, std::memory_order_release); }
+
+    private:
+        std::atomic<uint64_t>& epoch;
+    };
+
+    // Per-consumer deferred free list
+    struct Retired {
+        uint32_t handle;
+        uint64_t epoch;
+    };
+
+    /**
+     * @brief Call after the handle was unlinked (replaced in its PublishedSlot).
+     */
+    void retire(std::vector<Retired>& limbo, uint32_t handle, ThreadStats& stats) {
+        limbo.push_back({handle, global_epoch.fetch_add(1, std::memory_order_seq_cst)});
+        if (limbo.size() >= RECLAIM_BATCH) reclaim(limbo);
+        stats.deferred.store((long)limbo.size(), std::memory_order_relaxed);
+    }
+
+    void reclaim(std::vector<Retired>& limbo) {
+        uint64_t oldest = UINT64_MAX;
+        for (int r = 0; r < next_reader.load(); r++) {
+            uint64_t e = readers[r].epoch.load(std::memory_order_seq_cst);
+            if (e != 0) oldest = std::min(oldest, e);
+        }
+        size_t kept = 0;
+        for (const Retired& entry : limbo) {
+            if (entry.epoch < oldest) free_handles.try_push(entry.handle);
+            else limbo[kept++] = entry;
+        }
+        limbo.resize(kept);
+    }
+
+private:
+    struct alignas(64) ReaderSlot {
+        std::atomic<uint64_t> epoch{0};     // 0 = quiescent
+    };
+
+    ReaderSlot readers[MAX_READERS];
+    std::atomic<int> next_reader{0};
+    alignas(64) std::atomic<uint64_t> global_epoch{1};
+};
+
+EpochReclaimer reclaimer;
+
+// --- 7. Receiver, Consumer and Reader Threads ---
+
+/**
+ * @brief One receive shard: own SO_REUSEPORT socket, own reassembly table, shared pool.
+ */
+void receiver_thread(int index, int sockfd, Steering steering, ThreadStats& stats) {
+    if (steering == Steering::BPF) {
+        int cpu = index % (int)std::max(1u, std::thread::hardware_concurrency());
+        if (pin_to_cpu(cpu)) stats.cpu = cpu;
+    }
+
+    std::map<uint32_t, uint32_t> in_flight; // identification -> pool handle
+    unsigned char packet_buffer[MAX_PACKET_SIZE];
+    long packets = 0;
+    int candidate_cpu = -1;
+
+    while (running) {
+        ssize_t received_bytes = recv(sockfd, packet_buffer, MAX_PACKET_SIZE, 0);
+        if (received_bytes <= 0) continue;
+        if (steering == Steering::CPU && packets++ % STEER_CHECK_PACKETS == 0) {
+            follow_incoming_cpu(sockfd, stats, candidate_cpu);
+        }
+        if (received_bytes <= (ssize_t)MS3_PREAMBLE_SIZE || std::memcmp(packet_buffer, "MS3 MD", 6) != 0) continue;
+
+        MS3_Preamble pre;
+        std::memcpy(&pre, packet_buffer, sizeof(pre));
+        uint32_t id = le_to_h_u32(pre.identification);
+        size_t total = le_to_h_u32(pre.total_length);
+        size_t frag_offset = le_to_h_u32(pre.fragment_offset);
+        size_t frag_len = received_bytes - MS3_PREAMBLE_SIZE;
+        if (total > MAX_SCAN_SIZE || frag_offset + frag_len > total) continue;
+
+        auto it = in_flight.find(id);
+        if (it == in_flight.end()) {
+            uint32_t handle;
+            if (!free_handles.try_pop(handle)) { stats.dropped++; continue; }
+            ScanBuffer& fresh = scan_pool[handle];
+            fresh.length = total;
+            fresh.received = 0;
+            fresh.receiver = index;
+            it = in_flight.emplace(id, handle).first;
+        }
+        ScanBuffer& scan = scan_pool[it->second];
+        std::memcpy(scan.data.data() + frag_offset, packet_buffer + MS3_PREAMBLE_SIZE, frag_len);
+        scan.received += frag_len;
+
+        if (scan.received >= scan.length) {
+            // The ring has room for every handle, so this cannot fail
+            ready_handles.try_push(it->second);
+            in_flight.erase(it);
+            stats.scans++;
+        }
+
+        // Forget scans that lost a fragment and return their buffers
+        while (!in_flight.empty() && id - in_flight.begin()->first > REASSEMBLY_WINDOW) {
+            free_handles.try_push(in_flight.begin()->second);
+            in_flight.erase(in_flight.begin());
+            stats.dropped++;
+        }
+    }
+
+    close(sockfd);
+}
+
+/**
+ * @brief Shared consumer (recorder/fusion stand-in): batch dequeue, touch the scan, give it back.
+ * With fan-out readers the scan is published instead and the one it replaces is retired.
+ */
+void consumer_thread(ThreadStats& stats, std::atomic<unsigned long>& sink, bool fan_out) {
+    uint32_t handles[DEQUEUE_BATCH];
+    std::vector<EpochReclaimer::Retired> limbo;
+    while (running) {
+        size_t n = ready_handles.try_pop_batch(handles, DEQUEUE_BATCH);
+        if (n == 0) {
+            if (!limbo.empty()) {
+                reclaimer.reclaim(limbo);
+                stats.deferred.store((long)limbo.size(), std::memory_order_relaxed);
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            continue;
+        }
+        stats.batches++;
+        for (size_t i = 0; i < n; i++) {
+            const ScanBuffer& scan = scan_pool[handles[i]];
+            unsigned long sum = 0;
+            for (uint32_t b = 0; b < scan.length; b += 64) sum += scan.data[b];
+            sink += sum;
+            stats.scans++;
+            if (!fan_out) {
+                free_handles.try_push(handles[i]);
+                continue;
+            }
+            // Sequence per shard, so readers can tell how many scans they skipped
+            std::atomic<uint64_t>& slot = published[scan.receiver].current;
+            uint64_t previous = slot.load(std::memory_order_relaxed);
+            while (!slot.compare_exchange_weak(previous, (((previous >> 32) + 1) << 32) | handles[i], std::memory_order_seq_cst)) {}
+            if (previous != 0) reclaimer.retire(limbo, (uint32_t)previous, stats);
+        }
+    }
+}
+
+/**
+ * @brief Fan-out reader (recorder, zone evaluator, publisher or tracker stand-in): samples the latest
+ * scan of every shard. Skipped scans are counted; a reader that falls behind never blocks the pool.
+ */
+void reader_thread(int reader, ThreadStats& stats, std::atomic<unsigned long>& sink) {
+    std::vector<uint64_t> seen(published.size(), 0);
+    while (running) {
+        bool any = false;
+        for (size_t r = 0; r < published.size(); r++) {
+            EpochReclaimer::Guard guard(reclaimer, reader);
+            uint64_t current = published[r].current.load(std::memory_order_acquire);
+            if (current == seen[r]) continue;
+            // Sequences are 32 bits; the unsigned difference stays correct across a wrap
+            uint32_t advanced = (uint32_t)((current >> 32) - (seen[r] >> 32));
+            if (seen[r] != 0 && advanced > 1) stats.dropped += advanced - 1;
+            seen[r] = current;
+            const ScanBuffer& scan = scan_pool[(uint32_t)current];
+            unsigned long sum = 0;
+            for (uint32_t b = 0; b < scan.length; b += 64) sum += scan.data[b];
+            sink += sum;
+            stats.scans++;
+            any = true;
+        }
+        if (!any) std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+// --- 8. Main Program ---
+
+int main(int argc, char** argv) {
+    int receivers = 0;                      // 0 = default: 2, or one per CPU with --steer bpf
+    int consumers = 2;
+    Steering steering = Steering::CPU;
+    int readers = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        std::string value = argv[i + 1];
+        if (arg == "--receivers") receivers = std::max(1, std::atoi(argv[i + 1]));
+        else if (arg == "--consumers") consumers = std::max(1, std::atoi(argv[i + 1]));
+        else if (arg == "--readers") readers = std::clamp(std::atoi(argv[i + 1]), 0, MAX_READERS);
+        else if (arg == "--steer") steering = value == "bpf" ? Steering::BPF : value == "none" ? Steering::NONE : Steering::CPU;
+    }
+    int cpus = (int)std::max(1u, std::thread::hardware_concurrency());
+    if (receivers == 0) receivers = steering == Steering::BPF ? cpus : 2;
+    if (steering == Steering::BPF && receivers != cpus) {
+        std::cerr << "[WARNING] " << receivers << " receivers on " << cpus << " CPUs: the BPF selector only keeps "
+                  << "packets on their softirq CPU with one receiver per CPU" << std::endl;
+    }
+
+    // Sockets are opened here, in order, so socket r is index r of the reuseport group
+    std::vector<int> sockets;
+    for (int r = 0; r < receivers; r++) {
+        int sockfd = open_receiver_socket();
+        if (sockfd < 0) {
+            std::cerr << "Error: Receiver " << r << " could not bind to port " << PORT << std::endl;
+            return 1;
+        }
+        sockets.push_back(sockfd);
+    }
+    if (steering == Steering::BPF && !attach_cpu_selector(sockets[0], receivers)) {
+        std::cerr << "[WARNING] SO_ATTACH_REUSEPORT_CBPF failed (" << std::strerror(errno)
+                  << "), falling back to SO_INCOMING_CPU steering" << std::endl;
+        steering = Steering::CPU;
+    }
+
+    for (uint32_t h = 0; h < POOL_SCANS; h++) {
+        scan_pool[h].data.resize(MAX_SCAN_SIZE);
+        free_handles.try_push(h);
+    }
+
+    std::cout << "--- Starting " << receivers << " SO_REUSEPORT receivers -> " << consumers
+              << " consumers on port " << PORT << " (steering: "
+              << (steering == Steering::BPF ? "bpf" : steering == Steering::CPU ? "cpu" : "none") << ") ---" << std::endl;
+
+    std::vector<ThreadStats> receiver_stats(receivers);
+    std::vector<ThreadStats> consumer_stats(consumers);
+    std::vector<ThreadStats> reader_stats(readers);
+    std::atomic<unsigned long> sink{0};
+    std::vector<std::thread> threads;
+    published = std::vector<PublishedSlot>(receivers);
+    for (int r = 0; r < receivers; r++) threads.emplace_back(receiver_thread, r, sockets[r], steering, std::ref(receiver_stats[r]));
+    for (int c = 0; c < consumers; c++) threads.emplace_back(consumer_thread, std::ref(consumer_stats[c]), std::ref(sink), readers > 0);
+    for (int k = 0; k < readers; k++) threads.emplace_back(reader_thread, reclaimer.register_reader(), std::ref(reader_stats[k]), std::ref(sink));
+
+    while (running) {
+        std::this_thread::sleep_for(std::chrono::seconds(2));
+        std::cout << "[INFO]";
+        for (int r = 0; r < receivers; r++) {
+            std::cout << " rx" << r << "=" << receiver_stats[r].scans << " (" << receiver_stats[r].dropped << " dropped";
+            if (receiver_stats[r].cpu >= 0) std::cout << ", cpu " << receiver_stats[r].cpu;
+            if (receiver_stats[r].napi_id > 0) std::cout << ", napi " << receiver_stats[r].napi_id;
+            std::cout << ")";
+        }
+        for (int c = 0; c < consumers; c++) {
+            long batches = consumer_stats[c].batches;
+            std::cout << " | cons" << c << "=" << consumer_stats[c].scans << " in " << batches << " batches";
+            if (readers > 0) std::cout << " (" << consumer_stats[c].deferred << " deferred)";
+        }
+        static const char* roles[] = {"recorder", "zones", "publisher", "tracker"};
+        for (int k = 0; k < readers; k++) {
+            std::cout << " | " << roles[k % 4] << k << "=" << reader_stats[k].scans << " (" << reader_stats[k].dropped << " skipped)";
+        }
+        std::cout << std::endl;
+    }
+
+    for (auto& t : threads) t.join();
+    for (int sockfd : sockets) close(sockfd);
+    return 0;
+}
@@ -0,0 +1,1088 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <iomanip>
+#include <cmath>
+#include <new>
+#include <cerrno>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/un.h>
+#include <netinet/tcp.h>
+#include <chrono>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Live scan monitor for the dashboard.
+// Reassembles MS3 scans, decodes the measurement block and (with --pyramid) builds
+// min-preserving decimated copies of every scan (2x, 4x, 8x fewer beams).
+// Each bucket keeps its nearest return, so an obstacle is never hidden by decimation.
+// With --ws-port N the latest frames are streamed to browsers over WebSocket.
+// A per-sensor watchdog learns each scanner's period and reports overdue scans, stalls and
+// period drift from a timerfd tick, so the packet path only records one timestamp per scan.
+// Restart without losing state: the reassembly slots, watchdog models and counters live in the shared
+// memory segment STATE_SHM_NAME (versioned layout). `--takeover` asks the running instance for its
+// sockets over HANDOVER_SOCKET (SCM_RIGHTS), so queued fragments are not lost, then resumes the state.
+// The owner holds an exclusive flock on the segment; a second instance without --takeover refuses to start.
+// (Older glibc needs -lrt for shm_open.)
+
+constexpr int PORT = 1217;
+constexpr size_t MAX_PACKET_SIZE = 2048;
+constexpr size_t MS3_PREAMBLE_SIZE = 24;
+// Level 1 = 2x, level 2 = 4x, level 3 = 8x beam reduction
+constexpr int PYRAMID_LEVELS = 3;
+// Distance value meaning "no echo" in the measurement block
+constexpr uint16_t NO_ECHO = 0;
+// Scans reassembled concurrently (slot = identification % REASSEMBLY_SLOTS); a newer scan drops the old one
+constexpr size_t REASSEMBLY_SLOTS = 8;
+constexpr size_t MAX_SCAN_SIZE = 65536;
+// UDP socket receive buffer; kept across a takeover with the socket itself
+constexpr int RCVBUF_BYTES = 64 * 1024 * 1024;
+// Persisted state and handover
+constexpr const char* STATE_SHM_NAME = "/scan_monitor_state";
+constexpr const char* HANDOVER_SOCKET = "/tmp/scan_monitor.handover";
+constexpr uint32_t STATE_MAGIC = 0x54534D53;  // "SMST"
+constexpr uint32_t STATE_VERSION = 1;         // Bump on any change to SharedState or its members
+constexpr size_t MAX_SENSORS = 64;
+// Watchdog: scans used to learn the nominal period, check interval, default alarm thresholds
+constexpr int WATCHDOG_LEARN_SCANS = 50;
+constexpr int WATCHDOG_TICK_MS = 10;
+constexpr double WATCHDOG_OVERDUE_FACTOR = 3.0;
+constexpr double WATCHDOG_DRIFT = 0.05;
+// Weight of a new interval in the running period estimate
+constexpr double WATCHDOG_EWMA_ALPHA = 0.05;
+
+// --- 1. Utility for Little Endian to Host Conversion ---
+
+inline uint32_t le_to_h_u32(uint32_t value) {
+    #if __BYTE_ORDER == __LITTLE_ENDIAN || defined(__LITTLE_ENDIAN__)
+        return value;
+    #else
+        return (value >> 24) | ((value << 8) & 0x00FF0000) | ((value >> 8) & 0x0000FF00) | (value << 24);
+    #endif
+}
+
+inline uint16_t le_to_h_u16(uint16_t value) {
+    #if __BYTE_ORDER == __LITTLE_ENDIAN || defined(__LITTLE_ENDIAN__)
+        return value;
+    #else
+        return (value >> 8) | (value << 8);
+    #endif
+}
+
+// --- 2. Data Structure Definitions (Packed) ---
+#pragma pack(push, 1)
+
+struct MS3_Preamble {
+    char magic[6];              // "MS3 MD"
+    uint16_t version;           // Offset 6
+    uint32_t total_length;      // Offset 8  | Length of the reassembled scan
+    uint32_t identification;    // Offset 12 | Same for all fragments of one scan
+    uint32_t fragment_offset;   // Offset 16 | Position of the payload in the scan
+    uint32_t reserved;          // Offset 20
+}; // Total size: 24 bytes
+
+struct SICK_DataOutput_Header {
+    uint8_t version[4];         // 4 bytes | Struct Offset 0
+    uint32_t device_sn;         // 4 bytes | Struct Offset 4
+    uint32_t system_plug_sn;    // 4 bytes | Struct Offset 8
+    uint8_t channel_num;        // 1 byte  | Struct Offset 12
+    uint8_t reserved_1[3];      // 3 bytes | Struct Offset 13
+    uint32_t sequence_num;      // 4 bytes | Struct Offset 16
+    uint32_t scan_num;          // 4 bytes | Struct Offset 20 <--- Scan ID
+    uint16_t timestamp_date;    // 2 bytes | Struct Offset 24
+    uint16_t reserved_2;        // 2 bytes | Struct Offset 26
+    uint32_t timestamp_time;    // 4 bytes | Struct Offset 28 (ms since midnight)
+    uint16_t block_offset_size[10]; // Struct Offset 32: (offset, size) for the 5 data blocks
+    uint8_t remaining_header[60 - 52];
+}; // Total size: 60 bytes
+
+#pragma pack(pop)
+
+enum DataBlock { GENERAL_SYSTEM_STATE = 0, DERIVED_VALUES, MEASUREMENT_DATA, INTRUSION_DATA, APPLICATION_DATA };
+
+// A decoded scan as published to consumers: full resolution plus the optional pyramid.
+struct ScanFrame {
+    uint32_t device_sn = 0;
+    uint32_t scan_num = 0;
+    uint32_t time_ms = 0;
+    std::vector<uint16_t> distance;                 // Full resolution (mm)
+    std::vector<uint16_t> pyramid[PYRAMID_LEVELS];  // pyramid[k] has ceil(beams / 2^(k+1)) entries
+    bool has_pyramid = false;
+};
+
+// --- 3. Decode Stage with Pyramid Reduction ---
+
+/**
+ * @brief Extracts the beam distances into frame.distance and, if requested, the
+ * 2x/4x/8x min pyramid in the same pass over the beam records.
+ * NO_ECHO beams never win a bucket; a bucket without any echo stays NO_ECHO.
+ * @param beams Pointer to the first 4-byte beam record (distance, reflectivity, status).
+ */
+void decode_beams(const unsigned char* beams, size_t count, bool build_pyramid, ScanFrame& frame) {
+    frame.distance.resize(count);
+    frame.has_pyramid = build_pyramid;
+    for (int k = 0; k < PYRAMID_LEVELS; k++) {
+        frame.pyramid[k].assign(build_pyramid ? (count + (2u << k) - 1) / (2u << k) : 0, 0xFFFF);
+    }
+
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    // 8 beams per iteration: one 8x bucket, two 4x buckets and four 2x buckets.
+    // Values are kept biased by 0x8000 so the signed SSE2 min orders them as unsigned.
+    const __m128i low16 = _mm_set1_epi32(0xFFFF);
+    const __m128i bias32 = _mm_set1_epi32(0x8000);
+    const __m128i bias16 = _mm_set1_epi16((short)0x8000);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        __m128i r0 = _mm_loadu_si128((const __m128i*)(beams + i * 4));
+        __m128i r1 = _mm_loadu_si128((const __m128i*)(beams + i * 4 + 16));
+        __m128i d0 = _mm_sub_epi32(_mm_and_si128(r0, low16), bias32);
+        __m128i d1 = _mm_sub_epi32(_mm_and_si128(r1, low16), bias32);
+        __m128i raw = _mm_xor_si128(_mm_packs_epi32(d0, d1), bias16);
+        _mm_storeu_si128((__m128i*)(frame.distance.data() + i), raw);
+        if (!build_pyramid) continue;
+
+        __m128i no_echo = _mm_cmpeq_epi16(raw, zero);
+        __m128i key = _mm_xor_si128(_mm_or_si128(raw, no_echo), bias16);
+        __m128i m2 = _mm_min_epi16(key, _mm_srli_epi32(key, 16));
+        __m128i m4 = _mm_min_epi16(m2, _mm_srli_epi64(m2, 32));
+        __m128i m8 = _mm_min_epi16(m4, _mm_srli_si128(m4, 8));
+
+        uint16_t* p2 = frame.pyramid[0].data() + i / 2;
+        p2[0] = (uint16_t)(_mm_extract_epi16(m2, 0) ^ 0x8000);
+        p2[1] = (uint16_t)(_mm_extract_epi16(m2, 2) ^ 0x8000);
+        p2[2] = (uint16_t)(_mm_extract_epi16(m2, 4) ^ 0x8000);
+        p2[3] = (uint16_t)(_mm_extract_epi16(m2, 6) ^ 0x8000);
+        uint16_t* p4 = frame.pyramid[1].data() + i / 4;
+        p4[0] = (uint16_t)(_mm_extract_epi16(m4, 0) ^ 0x8000);
+        p4[1] = (uint16_t)(_mm_extract_epi16(m4, 4) ^ 0x8000);
+        frame.pyramid[2][i / 8] = (uint16_t)(_mm_extract_epi16(m8, 0) ^ 0x8000);
+    }
+#endif
+
+    for (; i < count; i++) {
+        uint16_t d;
+        std::memcpy(&d, beams + i * 4, 2);
+        d = le_to_h_u16(d);
+        frame.distance[i] = d;
+        if (!build_pyramid || d == NO_ECHO) continue;
+        for (int k = 0; k < PYRAMID_LEVELS; k++) {
+            uint16_t& bucket = frame.pyramid[k][i >> (k + 1)];
+            bucket = std::min(bucket, d);
+        }
+    }
+
+    // Buckets that only saw NO_ECHO beams
+    for (int k = 0; k < PYRAMID_LEVELS; k++) {
+        for (uint16_t& bucket : frame.pyramid[k]) {
+            if (bucket == 0xFFFF) bucket = NO_ECHO;
+        }
+    }
+}
+
+/**
+ * @brief Decodes one reassembled scan into a ScanFrame.
+ * @return false if the block directory points outside the buffer.
+ */
+bool decode_scan(const unsigned char* data, size_t length, bool build_pyramid, ScanFrame& frame) {
+    if (length < sizeof(SICK_DataOutput_Header)) return false;
+
+    SICK_DataOutput_Header header;
+    std::memcpy(&header, data, sizeof(header));
+
+    size_t offset = le_to_h_u16(header.block_offset_size[2 * MEASUREMENT_DATA]);
+    size_t size = le_to_h_u16(header.block_offset_size[2 * MEASUREMENT_DATA + 1]);
+    if (size < 4 || offset + size > length) return false;
+
+    uint32_t beam_count;
+    std::memcpy(&beam_count, data + offset, 4);
+    beam_count = le_to_h_u32(beam_count);
+    if (4 + (size_t)beam_count * 4 > size) return false;
+
+    frame.device_sn = le_to_h_u32(header.device_sn);
+    frame.scan_num = le_to_h_u32(header.scan_num);
+    frame.time_ms = le_to_h_u32(header.timestamp_time);
+    decode_beams(data + offset + 4, beam_count, build_pyramid, frame);
+    return true;
+}
+
+// --- 4. Publishing (Latest Frame per Sensor) ---
+
+// Consumers always read the most recent frame of each sensor.
+std::map<uint32_t, ScanFrame> published_frames;
+
+void publish_frame(ScanFrame& frame) {
+    std::swap(published_frames[frame.device_sn], frame);
+}
+
+/**
+ * @brief Smallest distance in a beam array, ignoring NO_ECHO beams.
+ */
+uint16_t nearest_return(const std::vector<uint16_t>& distance) {
+    uint16_t nearest = 0xFFFF;
+    for (uint16_t d : distance) {
+        if (d != NO_ECHO) nearest = std::min(nearest, d);
+    }
+    return nearest == 0xFFFF ? NO_ECHO : nearest;
+}
+
+// --- 5. WebSocket Server (RFC 6455, binary frames only) ---
+
+// Frame sent to browsers (little endian):
+//   "SM" | u8 level (0 = full, 1..3 = 2x/4x/8x) | u8 reserved | u32 device_sn | u32 scan_num
+//   | u32 time_ms | u16 beam count | u16 distance[beam count]
+constexpr size_t WS_FRAME_HEADER_SIZE = 20;
+// A handshake request larger than this is rejected
+constexpr size_t WS_MAX_REQUEST = 8192;
+constexpr int WS_DEFAULT_FPS = 10;
+constexpr int WS_MAX_CLIENTS = 64;
+// RFC 6455 5.5: control frame payloads are at most 125 bytes
+constexpr size_t WS_MAX_CONTROL_PAYLOAD = 125;
+
+/**
+ * @brief SHA-1 of a short message (only used for the Sec-WebSocket-Accept handshake).
+ */
+void sha1(const std::string& message, unsigned char digest[20]) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    std::string msg = message;
+    uint64_t bit_len = (uint64_t)message.size() * 8;
+    msg += (char)0x80;
+    while (msg.size() % 64 != 56) msg += (char)0x00;
+    for (int i = 7; i >= 0; i--) msg += (char)((bit_len >> (i * 8)) & 0xFF);
+
+    auto rol = [](uint32_t x, int n) { return (x << n) | (x >> (32 - n)); };
+    for (size_t chunk = 0; chunk < msg.size(); chunk += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            const unsigned char* p = (const unsigned char*)msg.data() + chunk + i * 4;
+            w[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+        }
+        for (int i = 16; i < 80; i++) w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20)      { f = (b & c) | (~b & d);           k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d;                    k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d);  k = 0x8F1BBCDC; }
+            else             { f = b ^ c ^ d;                    k = 0xCA62C1D6; }
+            uint32_t t = rol(a, 5) + f + e + k + w[i];
+            e = d; d = c; c = rol(b, 30); b = a; a = t;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+    for (int i = 0; i < 5; i++) {
+        digest[i * 4] = h[i] >> 24; digest[i * 4 + 1] = h[i] >> 16;
+        digest[i * 4 + 2] = h[i] >> 8; digest[i * 4 + 3] = h[i];
+    }
+}
+
+std::string base64_encode(const unsigned char* data, size_t length) {
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t v = (uint32_t)data[i] << 16;
+        if (i + 1 < length) v |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < length) v |= data[i + 2];
+        out += table[(v >> 18) & 63];
+        out += table[(v >> 12) & 63];
+        out += i + 1 < length ? table[(v >> 6) & 63] : '=';
+        out += i + 2 < length ? table[v & 63] : '=';
+    }
+    return out;
+}
+
+struct WsClient {
+    int fd = -1;
+    bool upgraded = false;
+    std::string inbuf;
+    std::vector<unsigned char> outbuf;
+    size_t out_pos = 0;
+    int level = 0;                      // Pyramid level the client asked for
+    int max_fps = WS_DEFAULT_FPS;
+    std::chrono::steady_clock::time_point next_send;
+    std::vector<uint32_t> dirty;        // Sensors with a newer frame than the one last sent
+    bool waiting_writable = false;      // EPOLLOUT registered
+    size_t pong_at = SIZE_MAX;          // Offset of a queued pong in outbuf, replaced by a newer ping
+    bool closing = false;               // Close frame queued; the socket closes once outbuf is sent
+};
+
+std::map<int, WsClient> ws_clients;
+int epoll_fd = -1;
+
+/**
+ * @brief Appends a server-to-client (unmasked, FIN) WebSocket frame header.
+ */
+void ws_append_frame_header(std::vector<unsigned char>& out, uint8_t opcode, size_t length) {
+    out.push_back(0x80 | opcode);
+    if (length < 126) {
+        out.push_back((unsigned char)length);
+    } else if (length <= 0xFFFF) {
+        out.push_back(126);
+        out.push_back(length >> 8);
+        out.push_back(length & 0xFF);
+    } else {
+        out.push_back(127);
+        for (int i = 7; i >= 0; i--) out.push_back((length >> (i * 8)) & 0xFF);
+    }
+}
+
+/**
+ * @brief Appends the binary frame for one sensor at the client's level (full resolution if no pyramid).
+ */
+void ws_append_scan(std::vector<unsigned char>& out, const ScanFrame& f, int level) {
+    if (!f.has_pyramid) level = 0;
+    const std::vector<uint16_t>& beams = level == 0 ? f.distance : f.pyramid[level - 1];
+    size_t payload = WS_FRAME_HEADER_SIZE + beams.size() * 2;
+    ws_append_frame_header(out, 0x2, payload);
+
+    auto put32 = [&out](uint32_t v) { for (int i = 0; i < 4; i++) out.push_back((v >> (i * 8)) & 0xFF); };
+    out.push_back('S');
+    out.push_back('M');
+    out.push_back((unsigned char)level);
+    out.push_back(0);
+    put32(f.device_sn);
+    put32(f.scan_num);
+    put32(f.time_ms);
+    out.push_back(beams.size() & 0xFF);
+    out.push_back((beams.size() >> 8) & 0xFF);
+    out.push_back(0);
+    out.push_back(0);
+    for (uint16_t d : beams) {
+        out.push_back(d & 0xFF);
+        out.push_back(d >> 8);
+    }
+}
+
+void ws_close_client(int fd) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    ws_clients.erase(fd);
+}
+
+void ws_set_writable_interest(WsClient& c, bool enable) {
+    if (c.waiting_writable == enable) return;
+    epoll_event ev{};
+    ev.events = EPOLLIN | (enable ? (uint32_t)EPOLLOUT : 0u);
+    ev.data.fd = c.fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c.fd, &ev);
+    c.waiting_writable = enable;
+}
+
+/**
+ * @brief Writes pending bytes; when the previous batch is fully sent and the rate limit allows,
+ * encodes the latest frame of every dirty sensor (latest wins, nothing queues up behind a slow client).
+ * @return false if the client was closed.
+ */
+bool ws_flush(WsClient& c) {
+    auto now = std::chrono::steady_clock::now();
+    if (!c.closing && c.out_pos == c.outbuf.size() && !c.dirty.empty() && now >= c.next_send) {
+        c.outbuf.clear();
+        c.out_pos = 0;
+        c.pong_at = SIZE_MAX;
+        for (uint32_t sensor : c.dirty) {
+            auto it = published_frames.find(sensor);
+            if (it != published_frames.end()) ws_append_scan(c.outbuf, it->second, c.level);
+        }
+        c.dirty.clear();
+        c.next_send = now + std::chrono::microseconds(1000000 / c.max_fps);
+    }
+
+    while (c.out_pos < c.outbuf.size()) {
+        ssize_t n = send(c.fd, c.outbuf.data() + c.out_pos, c.outbuf.size() - c.out_pos, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            ws_close_client(c.fd);
+            return false;
+        }
+        c.out_pos += n;
+    }
+    if (c.closing && c.out_pos == c.outbuf.size()) { ws_close_client(c.fd); return false; }
+    ws_set_writable_interest(c, c.out_pos < c.outbuf.size());
+    return true;
+}
+
+/**
+ * @brief Queues a control frame behind the bytes already pending, so it never splits a data frame.
+ * Only the latest unsent pong is kept (RFC 6455 5.5.3).
+ * @return false if the client was closed.
+ */
+bool ws_queue_control(WsClient& c, uint8_t opcode, const std::vector<unsigned char>& payload) {
+    if (c.out_pos == c.outbuf.size()) {
+        c.outbuf.clear();
+        c.out_pos = 0;
+        c.pong_at = SIZE_MAX;
+    }
+    if (opcode == 0xA && c.pong_at != SIZE_MAX && c.pong_at >= c.out_pos) {
+        c.outbuf.resize(c.pong_at);  // Nothing follows a queued pong but other control frames
+    }
+    if (opcode == 0xA) c.pong_at = c.outbuf.size();
+    ws_append_frame_header(c.outbuf, opcode, payload.size());
+    c.outbuf.insert(c.outbuf.end(), payload.begin(), payload.end());
+    return ws_flush(c);
+}
+
+/**
+ * @brief Reads the value of a "key=value" parameter from the request line's query string.
+ */
+int ws_query_param(const std::string& request_line, const std::string& key, int fallback) {
+    size_t q = request_line.find('?');
+    if (q == std::string::npos) return fallback;
+    size_t pos = request_line.find(key + "=", q);
+    if (pos == std::string::npos) return fallback;
+    return std::atoi(request_line.c_str() + pos + key.size() + 1);
+}
+
+/**
+ * @brief Completes the HTTP upgrade once the full request has arrived.
+ * @return false if the request is invalid and the client was closed.
+ */
+bool ws_handle_handshake(WsClient& c) {
+    size_t end = c.inbuf.find("\r\n\r\n");
+    if (end == std::string::npos) {
+        if (c.inbuf.size() > WS_MAX_REQUEST) { ws_close_client(c.fd); return false; }
+        return true;
+    }
+
+    std::string request = c.inbuf.substr(0, end);
+    const std::string key_header = "Sec-WebSocket-Key:";
+    size_t key_pos = request.find(key_header);
+    if (request.compare(0, 4, "GET ") != 0 || key_pos == std::string::npos) {
+        const char* reply = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
+        send(c.fd, reply, strlen(reply), MSG_NOSIGNAL);
+        ws_close_client(c.fd);
+        return false;
+    }
+    size_t key_start = request.find_first_not_of(' ', key_pos + key_header.size());
+    size_t key_end = request.find("\r\n", key_start);
+    std::string key = request.substr(key_start, key_end - key_start);
+    while (!key.empty() && key.back() == ' ') key.pop_back();
+
+    unsigned char digest[20];
+    sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11", digest);
+    std::string reply = "HTTP/1.1 101 Switching Protocols\r\n"
+                        "Upgrade: websocket\r\n"
+                        "Connection: Upgrade\r\n"
+                        "Sec-WebSocket-Accept: " + base64_encode(digest, 20) + "\r\n\r\n";
+
+    std::string request_line = request.substr(0, request.find("\r\n"));
+    c.level = std::clamp(ws_query_param(request_line, "level", 0), 0, PYRAMID_LEVELS);
+    c.max_fps = std::clamp(ws_query_param(request_line, "fps", WS_DEFAULT_FPS), 1, 100);
+    c.inbuf.erase(0, end + 4);
+    c.upgraded = true;
+    c.outbuf.assign(reply.begin(), reply.end());
+    c.out_pos = 0;
+    for (const auto& entry : published_frames) c.dirty.push_back(entry.first);
+
+    std::cout << "[INFO] WebSocket client " << c.fd << " connected (level " << c.level
+              << ", max " << c.max_fps << " fps)" << std::endl;
+    return ws_flush(c);
+}
+
+/**
+ * @brief Handles client-to-server frames: answers ping and close, ignores everything else.
+ * @return false if the client was closed.
+ */
+bool ws_handle_frames(WsClient& c) {
+    while (c.inbuf.size() >= 2) {
+        const unsigned char* p = (const unsigned char*)c.inbuf.data();
+        uint8_t opcode = p[0] & 0x0F;
+        bool masked = p[1] & 0x80;
+        uint64_t length = p[1] & 0x7F;
+        size_t header = 2;
+        if (length == 126) {
+            if (c.inbuf.size() < 4) return true;
+            length = ((uint64_t)p[2] << 8) | p[3];
+            header = 4;
+        } else if (length == 127) {
+            if (c.inbuf.size() < 10) return true;
+            length = 0;
+            for (int i = 0; i < 8; i++) length = (length << 8) | p[2 + i];
+            header = 10;
+        }
+        // Clients must mask their frames (RFC 6455 5.1); we never expect large ones.
+        if (!masked || length > WS_MAX_REQUEST || (opcode >= 0x8 && length > WS_MAX_CONTROL_PAYLOAD)) { ws_close_client(c.fd); return false; }
+        if (c.inbuf.size() < header + 4 + length) return true;
+
+        std::vector<unsigned char> payload(length);
+        for (size_t i = 0; i < length; i++) payload[i] = p[header + 4 + i] ^ p[header + (i % 4)];
+        c.inbuf.erase(0, header + 4 + length);
+
+        if (opcode == 0x8) {
+            // Pending frames go out first; anything the client sends after its close is ignored
+            c.closing = true;
+            c.dirty.clear();
+            c.inbuf.clear();
+            return ws_queue_control(c, 0x8, {});
+        }
+        if (opcode == 0x9 && !ws_queue_control(c, 0xA, payload)) return false;
+    }
+    return true;
+}
+
+void ws_handle_readable(int fd) {
+    char buf[4096];
+    while (true) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) { ws_close_client(fd); return; }
+        if (n < 0) break;
+        ws_clients[fd].inbuf.append(buf, n);
+    }
+    WsClient& c = ws_clients[fd];
+    if (c.closing) { c.inbuf.clear(); return; }
+    if (!c.upgraded && !ws_handle_handshake(c)) return;
+    if (c.upgraded) ws_handle_frames(c);
+}
+
+void ws_accept_clients(int listen_fd) {
+    while (true) {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK);
+        if (fd < 0) return;
+        if ((int)ws_clients.size() >= WS_MAX_CLIENTS) { close(fd); continue; }
+        int nodelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+        ws_clients[fd].fd = fd;
+    }
+}
+
+/**
+ * @brief Marks the sensor dirty for every connected client and sends where the rate limit allows.
+ */
+void ws_notify(uint32_t sensor) {
+    for (auto it = ws_clients.begin(); it != ws_clients.end();) {
+        WsClient& c = (it++)->second;
+        if (!c.upgraded || c.closing) continue;
+        if (std::find(c.dirty.begin(), c.dirty.end(), sensor) == c.dirty.end()) c.dirty.push_back(sensor);
+        ws_flush(c);
+    }
+}
+
+/**
+ * @brief Milliseconds until the next rate-limited client may send (-1 = nothing pending).
+ */
+int ws_next_timeout() {
+    auto now = std::chrono::steady_clock::now();
+    int timeout = -1;
+    for (const auto& entry : ws_clients) {
+        const WsClient& c = entry.second;
+        if (!c.upgraded || c.dirty.empty() || c.out_pos < c.outbuf.size()) continue;
+        int ms = (int)std::max<long>(0, std::chrono::duration_cast<std::chrono::milliseconds>(c.next_send - now).count() + 1);
+        timeout = timeout < 0 ? ms : std::min(timeout, ms);
+    }
+    return timeout;
+}
+
+// --- 6. Sensor Stall and Scan-Period Watchdog ---
+
+// Plain data only: lives in the persisted state segment. steady_clock is CLOCK_MONOTONIC, which is
+// system-wide, so last_scan stays meaningful for the process that takes over.
+struct SensorWatch {
+    uint32_t sensor = 0;
+    std::chrono::steady_clock::time_point last_scan;
+    double period_ms = 0;       // Running (EWMA) scan period
+    double nominal_ms = 0;      // Period learned over the first WATCHDOG_LEARN_SCANS scans
+    int intervals = 0;
+    bool overdue = false;       // Alarm raised, waiting for the next scan
+    bool drifting = false;
+    long stalls = 0;
+    double longest_stall_ms = 0;
+    double total_stall_ms = 0;
+};
+
+struct SensorTable {
+    uint32_t count;
+    SensorWatch entries[MAX_SENSORS];
+};
+
+SensorTable* sensor_watch = nullptr;  // Points into the persisted state
+double overdue_factor = WATCHDOG_OVERDUE_FACTOR;
+double drift_limit = WATCHDOG_DRIFT;
+
+/**
+ * @brief Watchdog entry of a sensor, or nullptr if it has not sent a scan yet.
+ */
+SensorWatch* find_watch(uint32_t sensor) {
+    for (uint32_t i = 0; i < sensor_watch->count; i++) {
+        if (sensor_watch->entries[i].sensor == sensor) return &sensor_watch->entries[i];
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Records a completed scan. Called once per scan, never per packet.
+ */
+void watchdog_scan(uint32_t sensor, std::chrono::steady_clock::time_point now) {
+    SensorWatch* found = find_watch(sensor);
+    if (!found) {
+        if (sensor_watch->count == MAX_SENSORS) return;
+        SensorWatch& w = sensor_watch->entries[sensor_watch->count++];
+        w = SensorWatch();
+        w.sensor = sensor;
+        w.last_scan = now;
+        return;
+    }
+    SensorWatch& w = *found;
+    double interval_ms = std::chrono::duration<double, std::milli>(now - w.last_scan).count();
+    w.last_scan = now;
+
+    if (w.overdue) {
+        // The gap is the stall; it does not feed the period estimate
+        w.overdue = false;
+        w.stalls++;
+        w.total_stall_ms += interval_ms;
+        w.longest_stall_ms = std::max(w.longest_stall_ms, interval_ms);
+        std::cout << "[INFO] Sensor " << sensor << " recovered after " << std::fixed << std::setprecision(1)
+                  << interval_ms << " ms without scans" << std::endl;
+        return;
+    }
+
+    w.intervals++;
+    w.period_ms = w.intervals == 1 ? interval_ms : w.period_ms + WATCHDOG_EWMA_ALPHA * (interval_ms - w.period_ms);
+    if (w.intervals < WATCHDOG_LEARN_SCANS) return;
+    if (w.intervals == WATCHDOG_LEARN_SCANS) {
+        w.nominal_ms = w.period_ms;
+        std::cout << "[INFO] Sensor " << sensor << " nominal scan period " << std::fixed << std::setprecision(2)
+                  << w.nominal_ms << " ms" << std::endl;
+        return;
+    }
+
+    bool drifting = std::abs(w.period_ms - w.nominal_ms) > drift_limit * w.nominal_ms;
+    if (drifting != w.drifting) {
+        w.drifting = drifting;
+        std::cout << (drifting ? "[WARNING] Sensor " : "[INFO] Sensor ") << sensor << " scan period "
+                  << std::fixed << std::setprecision(2) << w.period_ms << " ms "
+                  << (drifting ? "drifted from nominal " : "back near nominal ") << w.nominal_ms << " ms" << std::endl;
+    }
+}
+
+/**
+ * @brief Timer tick: raises one overdue event per stall for every sensor with a learned period.
+ */
+void watchdog_tick(std::chrono::steady_clock::time_point now) {
+    for (uint32_t i = 0; i < sensor_watch->count; i++) {
+        SensorWatch& w = sensor_watch->entries[i];
+        if (w.overdue || w.nominal_ms <= 0) continue;
+        double silent_ms = std::chrono::duration<double, std::milli>(now - w.last_scan).count();
+        if (silent_ms > overdue_factor * w.nominal_ms) {
+            w.overdue = true;
+            std::cout << "[WARNING] Sensor " << w.sensor << " scan overdue: nothing for " << std::fixed
+                      << std::setprecision(1) << silent_ms << " ms (period " << w.nominal_ms << " ms)" << std::endl;
+        }
+    }
+}
+
+// --- 7. Persisted State and Socket Handover ---
+
+struct ReassemblySlot {
+    bool used;
+    uint32_t id;
+    uint32_t total;
+    uint32_t received;
+    unsigned char data[MAX_SCAN_SIZE];
+};
+
+// Everything a restarted process needs to continue where the old one stopped. Trivially copyable
+// members only; the header fields must all match or the segment is reinitialised.
+struct SharedState {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size;
+    uint64_t generation;        // Incremented by every process that attaches
+    long scan_counter;
+    long dropped_scans;
+    SensorTable sensors;
+    ReassemblySlot slots[REASSEMBLY_SLOTS];
+};
+
+/**
+ * @brief Opens the state segment and takes the exclusive ownership lock on it.
+ * The descriptor stays open for the process lifetime: closing it would release the lock.
+ * @return -1 if the segment cannot be opened or another instance holds the lock (errno EWOULDBLOCK).
+ */
+int lock_state() {
+    int fd = shm_open(STATE_SHM_NAME, O_CREAT | O_RDWR, 0600);
+    if (fd < 0) return -1;
+    if (flock(fd, LOCK_EX | LOCK_NB) < 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Maps the locked state segment, reinitialising it when the layout does not match.
+ * @return nullptr if the segment cannot be sized or mapped.
+ */
+SharedState* attach_state(int fd) {
+    struct stat st{};
+    fstat(fd, &st);
+    bool sized = (size_t)st.st_size == sizeof(SharedState);
+    if (!sized && ftruncate(fd, sizeof(SharedState)) < 0) return nullptr;
+    void* mem = mmap(nullptr, sizeof(SharedState), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED) return nullptr;
+
+    SharedState* state = (SharedState*)mem;
+    if (!sized || state->magic != STATE_MAGIC || state->version != STATE_VERSION || state->size != sizeof(SharedState)) {
+        state = new (mem) SharedState();  // Zeroed, then the SensorWatch defaults
+        state->magic = STATE_MAGIC;
+        state->version = STATE_VERSION;
+        state->size = sizeof(SharedState);
+        std::cout << "[INFO] Initialised state segment " << STATE_SHM_NAME << " (layout v" << STATE_VERSION << ")" << std::endl;
+    } else {
+        std::cout << "[INFO] Resumed state generation " << state->generation << ": " << state->scan_counter
+                  << " scans, " << state->sensors.count << " sensors" << std::endl;
+    }
+    state->generation++;
+    return state;
+}
+
+/**
+ * @brief Listening Unix socket on which a newer instance can ask for our sockets.
+ */
+int open_handover_listener() {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, HANDOVER_SOCKET, sizeof(addr.sun_path) - 1);
+    unlink(HANDOVER_SOCKET);
+    if (fd < 0 || bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 1) < 0) {
+        std::cerr << "[WARNING] Handover socket " << HANDOVER_SOCKET << " unavailable: " << strerror(errno) << std::endl;
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Old instance: sends the UDP socket, the locked state descriptor (and the WebSocket listener,
+ * if any) to the new one. The UDP socket is never closed, so datagrams arriving meanwhile wait in its
+ * receive queue; the flock belongs to the shared file description, so ownership moves with it.
+ */
+bool send_sockets(int handover_fd, int udp_fd, int state_fd, int ws_listen_fd) {
+    int peer = accept(handover_fd, nullptr, nullptr);
+    if (peer < 0) return false;
+    int fds[3] = {udp_fd, state_fd, ws_listen_fd};
+    int count = ws_listen_fd >= 0 ? 3 : 2;
+    char control[CMSG_SPACE(sizeof(fds))] = {};
+    char tag = 'H';
+    iovec iov{&tag, 1};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(count * sizeof(int));
+    cmsghdr* c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(count * sizeof(int));
+    std::memcpy(CMSG_DATA(c), fds, count * sizeof(int));
+    bool ok = sendmsg(peer, &msg, 0) == 1;
+    close(peer);
+    return ok;
+}
+
+/**
+ * @brief New instance: receives the sockets and the locked state descriptor of the running one.
+ * @return false if no instance is listening or the transfer failed.
+ */
+bool receive_sockets(int& udp_fd, int& state_fd, int& ws_listen_fd) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, HANDOVER_SOCKET, sizeof(addr.sun_path) - 1);
+    if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    int fds[3] = {-1, -1, -1};
+    char control[CMSG_SPACE(sizeof(fds))] = {};
+    char tag = 0;
+    iovec iov{&tag, 1};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t n = recvmsg(fd, &msg, 0);
+    close(fd);
+    cmsghdr* c = CMSG_FIRSTHDR(&msg);
+    if (n != 1 || tag != 'H' || !c || c->cmsg_type != SCM_RIGHTS) return false;
+    size_t count = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    std::memcpy(fds, CMSG_DATA(c), std::min<size_t>(count, 3) * sizeof(int));
+    if (count < 2) {
+        if (count == 1) close(fds[0]);
+        return false;
+    }
+    udp_fd = fds[0];
+    state_fd = fds[1];
+    ws_listen_fd = count > 2 ? fds[2] : -1;
+    return true;
+}
+
+/**
+ * @brief Requests `bytes` of receive buffer, retrying with SO_RCVBUFFORCE (CAP_NET_ADMIN) when
+ * net.core.rmem_max caps it. Same as dual_path_receiver.cpp.
+ * @return The granted size in request units; getsockopt reports twice that.
+ */
+int set_receive_buffer(int sockfd, int bytes) {
+    int granted = 0;
+    socklen_t len = sizeof(granted);
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+    getsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &granted, &len);
+    if (granted / 2 < bytes) {
+        setsockopt(sockfd, SOL_SOCKET, SO_RCVBUFFORCE, &bytes, sizeof(bytes));
+        getsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &granted, &len);
+    }
+    return granted / 2;
+}
+
+// --- 8. Main Program Loop (Single epoll Loop: UDP, WebSocket Listener, Clients, Watchdog Timer, Handover) ---
+
+int main(int argc, char** argv) {
+    using clock = std::chrono::steady_clock;
+
+    bool build_pyramid = false;
+    bool takeover = false;
+    int ws_port = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--pyramid") build_pyramid = true;
+        else if (arg == "--takeover") takeover = true;
+        else if (arg == "--ws-port" && i + 1 < argc) ws_port = std::atoi(argv[++i]);
+        else if (arg == "--overdue-factor" && i + 1 < argc) overdue_factor = std::max(1.5, std::atof(argv[++i]));
+        else if (arg == "--drift-pct" && i + 1 < argc) drift_limit = std::atof(argv[++i]) / 100.0;
+    }
+
+    // Ownership and sockets first (from the running instance if asked), then the state: the old
+    // instance stops touching the segment once it has sent its descriptors
+    auto takeover_start = clock::now();
+    int sockfd = -1;
+    int state_fd = -1;
+    int inherited_listen_fd = -1;
+    if (takeover && !receive_sockets(sockfd, state_fd, inherited_listen_fd)) {
+        std::cerr << "[WARNING] No running instance answered on " << HANDOVER_SOCKET << ", starting fresh." << std::endl;
+        takeover = false;
+    }
+    if (state_fd < 0) {
+        state_fd = lock_state();
+        if (state_fd < 0) {
+            if (errno == EWOULDBLOCK) std::cerr << "Error: Another instance owns " << STATE_SHM_NAME << " (use --takeover to replace it)" << std::endl;
+            else std::cerr << "Error: Could not open state segment " << STATE_SHM_NAME << ": " << strerror(errno) << std::endl;
+            return 1;
+        }
+    }
+    int reuse = 1;
+    if (sockfd < 0) {
+        sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (sockfd < 0) { std::cerr << "Error: Could not create socket." << std::endl; return 1; }
+        setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        int granted = set_receive_buffer(sockfd, RCVBUF_BYTES);
+        if (granted < RCVBUF_BYTES) {
+            std::cerr << "[WARNING] Receive buffer is " << granted / 1024 << " KB, not " << RCVBUF_BYTES / 1024
+                      << " KB: raise net.core.rmem_max or grant CAP_NET_ADMIN." << std::endl;
+        }
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = INADDR_ANY;
+        addr.sin_port = htons(PORT);
+        if (bind(sockfd, (sockaddr*)&addr, sizeof(addr)) < 0) { std::cerr << "Error: Could not bind to port " << PORT << " (use --takeover to replace a running instance)" << std::endl; close(sockfd); return 1; }
+        if (fcntl(sockfd, F_SETFL, O_NONBLOCK) < 0) { std::cerr << "Error: Could not set non-blocking mode." << std::endl; close(sockfd); return 1; }
+    }
+
+    SharedState* state = attach_state(state_fd);
+    if (!state) { std::cerr << "Error: Could not map state segment " << STATE_SHM_NAME << std::endl; close(sockfd); close(state_fd); return 1; }
+    sensor_watch = &state->sensors;
+    if (takeover) {
+        auto elapsed = std::chrono::duration<double, std::milli>(clock::now() - takeover_start);
+        std::cout << "[INFO] Took over the running instance's sockets in " << std::fixed << std::setprecision(2)
+                  << elapsed.count() << " ms" << std::endl;
+    }
+    int handover_fd = open_handover_listener();
+
+    epoll_fd = epoll_create1(0);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = sockfd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sockfd, &ev);
+
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    itimerspec tick{};
+    tick.it_interval.tv_nsec = WATCHDOG_TICK_MS * 1000000L;
+    tick.it_value = tick.it_interval;
+    timerfd_settime(timer_fd, 0, &tick, nullptr);
+    ev.data.fd = timer_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev);
+
+    int listen_fd = -1;
+    if (inherited_listen_fd >= 0 && ws_port > 0) {
+        listen_fd = inherited_listen_fd;
+        ev.data.fd = listen_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+    } else if (ws_port > 0) {
+        if (inherited_listen_fd >= 0) close(inherited_listen_fd);
+        listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in ws_addr{};
+        ws_addr.sin_family = AF_INET;
+        ws_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // Local dashboards only
+        ws_addr.sin_port = htons(ws_port);
+        if (bind(listen_fd, (sockaddr*)&ws_addr, sizeof(ws_addr)) < 0 || listen(listen_fd, 16) < 0) {
+            std::cerr << "Error: Could not listen on WebSocket port " << ws_port << std::endl;
+            close(timer_fd);
+            close(sockfd);
+            return 1;
+        }
+        ev.data.fd = listen_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+    } else if (inherited_listen_fd >= 0) {
+        close(inherited_listen_fd);
+    }
+    if (handover_fd >= 0) {
+        ev.data.fd = handover_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, handover_fd, &ev);
+    }
+
+    std::cout << "--- Starting Scan Monitor ---" << std::endl;
+    std::cout << "Listening for UDP packets on port " << PORT
+              << (build_pyramid ? " (publishing 2x/4x/8x pyramid)." : ".") << std::endl;
+    if (listen_fd >= 0) {
+        std::cout << "Streaming scans on ws://127.0.0.1:" << ws_port << "/?level=0..3&fps=N" << std::endl;
+    }
+
+    unsigned char packet_buffer[MAX_PACKET_SIZE];
+    ScanFrame frame;
+    long& scanCounter = state->scan_counter;
+    long& droppedScans = state->dropped_scans;
+    auto start_time = clock::now();
+    epoll_event events[32];
+    bool handed_over = false;
+
+    while (!handed_over) {
+        int ready = epoll_wait(epoll_fd, events, 32, ws_next_timeout());
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Error in epoll_wait: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        for (int e = 0; e < ready; e++) {
+            int fd = events[e].data.fd;
+            if (fd == listen_fd) { ws_accept_clients(listen_fd); continue; }
+            if (fd == handover_fd) {
+                // A newer instance takes over: stop reading, pass the sockets, leave the state as is
+                if (send_sockets(handover_fd, sockfd, state_fd, listen_fd)) {
+                    std::cout << "[INFO] Sockets handed over to the new instance, exiting." << std::endl;
+                    handed_over = true;
+                    break;
+                }
+                continue;
+            }
+            if (fd == timer_fd) {
+                uint64_t expirations;
+                if (read(timer_fd, &expirations, sizeof(expirations)) > 0) watchdog_tick(clock::now());
+                continue;
+            }
+            if (fd != sockfd) {
+                if (events[e].events & (EPOLLERR | EPOLLHUP)) { ws_close_client(fd); continue; }
+                if (events[e].events & EPOLLIN) ws_handle_readable(fd);
+                auto it = ws_clients.find(fd);
+                if (it != ws_clients.end() && (events[e].events & EPOLLOUT)) ws_flush(it->second);
+                continue;
+            }
+
+            // Drain the UDP socket
+            while (true) {
+                ssize_t received_bytes = recv(sockfd, packet_buffer, MAX_PACKET_SIZE, 0);
+                if (received_bytes < 0) break;
+                if ((size_t)received_bytes <= MS3_PREAMBLE_SIZE || std::memcmp(packet_buffer, "MS3 MD", 6) != 0) continue;
+
+                MS3_Preamble pre;
+                std::memcpy(&pre, packet_buffer, sizeof(pre));
+                uint32_t id = le_to_h_u32(pre.identification);
+                size_t total = le_to_h_u32(pre.total_length);
+                size_t frag_offset = le_to_h_u32(pre.fragment_offset);
+                size_t frag_len = received_bytes - MS3_PREAMBLE_SIZE;
+                if (total > MAX_SCAN_SIZE || frag_offset + frag_len > total) continue;
+
+                ReassemblySlot& slot = state->slots[id % REASSEMBLY_SLOTS];
+                if (!slot.used || slot.id != id) {
+                    // A newer scan takes the slot; the old one lost a fragment
+                    if (slot.used) droppedScans++;
+                    slot.used = true;
+                    slot.id = id;
+                    slot.total = total;
+                    slot.received = 0;
+                }
+                std::memcpy(slot.data + frag_offset, packet_buffer + MS3_PREAMBLE_SIZE, frag_len);
+                slot.received += frag_len;
+                if (slot.received < slot.total) continue;
+
+                slot.used = false;
+                bool decoded = decode_scan(slot.data, slot.total, build_pyramid, frame);
+
+                if (!decoded) continue;
+                uint32_t sensor = frame.device_sn;
+                watchdog_scan(sensor, clock::now());
+                publish_frame(frame);
+                ws_notify(sensor);
+                scanCounter++;
+
+                if (scanCounter % 100 == 0) {
+                    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start_time);
+                    std::cout << "[INFO] " << scanCounter << " scans published (" << droppedScans << " incomplete, "
+                              << ws_clients.size() << " WebSocket clients) in " << elapsed.count() << " ms" << std::endl;
+                    for (const auto& entry : published_frames) {
+                        const ScanFrame& f = entry.second;
+                        std::cout << "  Sensor " << entry.first << " | Scan " << f.scan_num << " | " << f.distance.size() << " beams";
+                        if (f.has_pyramid) {
+                            std::cout << " | pyramid " << f.pyramid[0].size() << "/" << f.pyramid[1].size() << "/" << f.pyramid[2].size()
+                                      << " | nearest (8x) " << nearest_return(f.pyramid[2]) << " mm";
+                        }
+                        if (const SensorWatch* w = find_watch(entry.first)) {
+                            std::cout << " | period " << std::fixed << std::setprecision(2) << w->period_ms << " ms | "
+                                      << w->stalls << " stalls (longest " << std::setprecision(0) << w->longest_stall_ms << " ms)";
+                        }
+                        std::cout << std::endl;
+                    }
+                    start_time = clock::now();
+                }
+            }
+        }
+
+        // Rate-limited clients whose interval has elapsed
+        for (auto it = ws_clients.begin(); it != ws_clients.end();) {
+            WsClient& c = (it++)->second;
+            if (c.upgraded && !c.dirty.empty() && c.out_pos == c.outbuf.size()) ws_flush(c);
+        }
+    }
+
+    for (auto& entry : ws_clients) close(entry.first);
+    if (listen_fd >= 0) close(listen_fd);
+    // After a handover the path belongs to the new instance; only close our descriptor
+    if (handover_fd >= 0) close(handover_fd);
+    munmap(state, sizeof(SharedState));
+    close(state_fd);  // Releases the lock unless the new instance holds the description
+    close(timer_fd);
+    close(epoll_fd);
+    close(sockfd);
+    return 0;
+}
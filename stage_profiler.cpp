@@ -0,0 +1,888 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <filesystem>
+#include <map>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <iomanip>
+#include <cerrno>
+#include <ctime>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// Per-stage cost breakdown of the scan pipeline using perf_event_open counters.
+// The counters are opened for the calling thread only and read at every stage boundary:
+//   receive -> reassemble -> checksum (byte-wise crc16_ccitt) -> decode (per-point memcpy) -> publish
+// Usage:
+//   ./stage_profiler                 live, UDP port 1217
+//   ./stage_profiler --dir ./packets --repeat 50   offline over the recordings (no receive stage)
+//   --fused   fragments are copied by a copy+checksum kernel (XOR, 8-bit sum and CRC16 per fragment);
+//             the checksum stage only combines the partial results, in offset order
+// Every receive batch is validated at once (validate_preambles): 8 preambles per SIMD step with AVX2,
+// 4 with SSE2, giving an accept mask plus identification/offset/length arrays for the reassembler.
+// Hardware counters are used when available; in VMs it falls back to software counters.
+// Syscalls are counted by the kernel (raw_syscalls:sys_enter tracepoint in the same counter group),
+// which needs tracefs and perf_event_paranoid <= 1; without it the syscall column is left out.
+//
+// Diagnostic build: g++ -DALLOC_ACCOUNTING ... also counts heap allocations per stage.
+// With --assert-steady-state the tool exits with status 1 if, after WARMUP_SCANS scans,
+// any stage allocates, the receive stage issues more than one syscall per batch or any other
+// stage issues a syscall at all (the syscall checks are skipped when syscalls cannot be counted).
+
+constexpr int PORT = 1217;
+constexpr size_t MAX_PACKET_SIZE = 2048;
+constexpr size_t MS3_PREAMBLE_SIZE = 24;
+// Only preamble version accepted by the batch validator
+constexpr uint16_t MS3_VERSION = 1;
+// Print the breakdown every REPORT_SCANS completed scans
+constexpr long REPORT_SCANS = 500;
+constexpr int MAX_COUNTERS = 4;
+// Tracepoint id files, tried in order
+const char* SYS_ENTER_ID_FILES[] = {"/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+                                    "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id"};
+// Scans reassembled concurrently; a slot is reused (and its scan dropped) after this many newer scans
+constexpr size_t REASSEMBLY_SLOTS = 8;
+// Preallocated size of one reassembly slot
+constexpr size_t MAX_SCAN_SIZE = 65536;
+// Datagrams per recvmmsg() call
+constexpr unsigned RECV_BATCH = 16;
+// Scans processed before the steady state is checked
+constexpr long WARMUP_SCANS = 64;
+// Partial checksums kept per reassembly slot (fragments per scan)
+constexpr size_t MAX_FRAGMENTS = 64;
+
+// --- 1. Utility for Little Endian to Host Conversion ---
+
+inline uint32_t le_to_h_u32(uint32_t value) {
+    #if __BYTE_ORDER == __LITTLE_ENDIAN || defined(__LITTLE_ENDIAN__)
+        return value;
+    #else
+        return (value >> 24) | ((value << 8) & 0x00FF0000) | ((value >> 8) & 0x0000FF00) | (value << 24);
+    #endif
+}
+
+inline uint16_t le_to_h_u16(uint16_t value) {
+    #if __BYTE_ORDER == __LITTLE_ENDIAN || defined(__LITTLE_ENDIAN__)
+        return value;
+    #else
+        return (value >> 8) | (value << 8);
+    #endif
+}
+
+// --- 2. Data Structure Definitions (Packed) ---
+#pragma pack(push, 1)
+
+struct MS3_Preamble {
+    char magic[6];              // "MS3 MD"
+    uint16_t version;           // Offset 6
+    uint32_t total_length;      // Offset 8  | Length of the reassembled scan
+    uint32_t identification;    // Offset 12 | Same for all fragments of one scan
+    uint32_t fragment_offset;   // Offset 16 | Position of the payload in the scan
+    uint32_t reserved;          // Offset 20
+}; // Total size: 24 bytes
+
+struct SICK_DataOutput_Header {
+    uint8_t version[4];         // 4 bytes | Struct Offset 0
+    uint32_t device_sn;         // 4 bytes | Struct Offset 4
+    uint32_t system_plug_sn;    // 4 bytes | Struct Offset 8
+    uint8_t channel_num;        // 1 byte  | Struct Offset 12
+    uint8_t reserved_1[3];      // 3 bytes | Struct Offset 13
+    uint32_t sequence_num;      // 4 bytes | Struct Offset 16
+    uint32_t scan_num;          // 4 bytes | Struct Offset 20 <--- Scan ID
+    uint16_t timestamp_date;    // 2 bytes | Struct Offset 24
+    uint16_t reserved_2;        // 2 bytes | Struct Offset 26
+    uint32_t timestamp_time;    // 4 bytes | Struct Offset 28 (ms since midnight)
+    uint16_t block_offset_size[10]; // Struct Offset 32: (offset, size) for the 5 data blocks
+    uint8_t remaining_header[60 - 52];
+}; // Total size: 60 bytes
+
+struct Point {
+    uint16_t distance_mm;
+    uint8_t reflectivity;
+    uint8_t status;
+};
+
+#pragma pack(pop)
+
+enum DataBlock { GENERAL_SYSTEM_STATE = 0, DERIVED_VALUES, MEASUREMENT_DATA, INTRUSION_DATA, APPLICATION_DATA };
+
+// --- 3. Allocation Accounting ---
+
+// Plain global: the pipeline runs on a single thread.
+unsigned long long g_allocations = 0;
+
+#ifdef ALLOC_ACCOUNTING
+void* operator new(size_t size) {
+    g_allocations++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+#endif
+
+// --- 4. Per-Thread Counters (perf_event_open) ---
+
+enum Stage { RECEIVE = 0, REASSEMBLE, CHECKSUM, DECODE, PUBLISH, STAGE_COUNT };
+const char* STAGE_NAMES[STAGE_COUNT] = {"receive", "reassemble", "checksum", "decode", "publish"};
+
+struct CounterSample {
+    uint64_t value[MAX_COUNTERS] = {};
+    uint64_t ns = 0;
+    uint64_t allocations = 0;
+    uint64_t syscalls = 0;
+};
+
+class StageCounters {
+public:
+    /**
+     * @brief Opens one counter group for the calling thread.
+     * Tries cycles/instructions/cache misses/branch misses first, then software counters.
+     */
+    bool open() {
+        const uint64_t hw[MAX_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                           PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        const char* hw_names[MAX_COUNTERS] = {"cycles", "instr", "cache-miss", "branch-miss"};
+        if (open_group(PERF_TYPE_HARDWARE, hw, hw_names, MAX_COUNTERS)) {
+            hardware = true;
+        } else {
+            const uint64_t sw[3] = {PERF_COUNT_SW_TASK_CLOCK, PERF_COUNT_SW_PAGE_FAULTS, PERF_COUNT_SW_CONTEXT_SWITCHES};
+            const char* sw_names[3] = {"task-ns", "page-faults", "ctx-switch"};
+            if (!open_group(PERF_TYPE_SOFTWARE, sw, sw_names, 3)) return false;
+        }
+        open_syscall_counter();
+        return true;
+    }
+
+    ~StageCounters() {
+        for (int i = 0; i < count; i++) close(fds[i]);
+        if (syscall_fd >= 0) close(syscall_fd);
+    }
+
+    /**
+     * @brief Reads all counters of the group with a single read() call.
+     */
+    void sample(CounterSample& s) const {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        s.ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+        s.allocations = g_allocations;
+        if (count == 0) return;
+
+        // The syscall counter is the last group member; the read() below is itself counted, so every
+        // sample subtracts the reads made so far
+        uint64_t buf[2 + MAX_COUNTERS];
+        int members = count + (counts_syscalls ? 1 : 0);
+        if (read(fds[0], buf, sizeof(uint64_t) * (1 + members)) > 0) {
+            for (int i = 0; i < count && i < (int)buf[0]; i++) s.value[i] = buf[1 + i];
+            if (counts_syscalls && (int)buf[0] == members) s.syscalls = buf[1 + count] - ++sample_reads;
+        }
+    }
+
+    int count = 0;
+    bool hardware = false;
+    bool counts_syscalls = false;
+    const char* names[MAX_COUNTERS] = {};
+
+private:
+    /**
+     * @brief Adds a raw_syscalls:sys_enter counter for this thread to the group.
+     * Kernel events must be included: the tracepoint fires in kernel mode.
+     */
+    void open_syscall_counter() {
+        uint64_t id = 0;
+        for (const char* path : SYS_ENTER_ID_FILES) {
+            std::ifstream file(path);
+            if (file >> id) break;
+        }
+        if (id == 0) return;
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_TRACEPOINT;
+        attr.config = id;
+        attr.read_format = PERF_FORMAT_GROUP;
+        syscall_fd = syscall(SYS_perf_event_open, &attr, 0, -1, fds[0], 0);
+        counts_syscalls = syscall_fd >= 0;
+    }
+
+    bool open_group(uint32_t type, const uint64_t* configs, const char** config_names, int n) {
+        for (int i = 0; i < n; i++) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = type;
+            attr.config = configs[i];
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            attr.disabled = (i == 0);
+            int fd = syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds[0], 0);
+            if (fd < 0) {
+                for (int j = 0; j < i; j++) close(fds[j]);
+                count = 0;
+                return false;
+            }
+            fds[i] = fd;
+            names[i] = config_names[i];
+        }
+        count = n;
+        ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        return true;
+    }
+
+    int fds[MAX_COUNTERS] = {-1, -1, -1, -1};
+    int syscall_fd = -1;
+    mutable uint64_t sample_reads = 0;
+};
+
+// Accumulated cost per stage; the current stage is charged whenever the next boundary is crossed.
+struct StageProfile {
+    uint64_t total[STAGE_COUNT][MAX_COUNTERS] = {};
+    uint64_t total_ns[STAGE_COUNT] = {};
+    uint64_t total_allocations[STAGE_COUNT] = {};
+    uint64_t total_syscalls[STAGE_COUNT] = {};
+    CounterSample last;
+    const StageCounters* counters = nullptr;
+
+    void start() { counters->sample(last); }
+
+    void boundary(Stage finished) {
+        CounterSample now;
+        counters->sample(now);
+        for (int i = 0; i < counters->count; i++) total[finished][i] += now.value[i] - last.value[i];
+        total_ns[finished] += now.ns - last.ns;
+        total_allocations[finished] += now.allocations - last.allocations;
+        total_syscalls[finished] += now.syscalls - last.syscalls;
+        last = now;
+    }
+
+    uint64_t all_syscalls() const {
+        uint64_t n = 0;
+        for (int s = 0; s < STAGE_COUNT; s++) n += total_syscalls[s];
+        return n;
+    }
+
+    uint64_t all_allocations() const {
+        uint64_t n = 0;
+        for (int s = 0; s < STAGE_COUNT; s++) n += total_allocations[s];
+        return n;
+    }
+
+    void report(long scans) const {
+        std::cout << "\n[PROFILE] Per-scan cost over " << scans << " scans ("
+                  << (counters->hardware ? "hardware" : "software") << " counters)" << std::endl;
+        std::cout << "  " << std::left << std::setw(12) << "stage" << std::right << std::setw(12) << "wall-ns";
+        for (int i = 0; i < counters->count; i++) std::cout << std::setw(13) << counters->names[i];
+        if (counters->hardware) std::cout << std::setw(8) << "IPC";
+#ifdef ALLOC_ACCOUNTING
+        std::cout << std::setw(10) << "allocs";
+#endif
+        if (counters->counts_syscalls) std::cout << std::setw(10) << "syscalls";
+        std::cout << std::endl;
+
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            std::cout << "  " << std::left << std::setw(12) << STAGE_NAMES[s] << std::right
+                      << std::setw(12) << total_ns[s] / scans;
+            for (int i = 0; i < counters->count; i++) std::cout << std::setw(13) << total[s][i] / scans;
+            if (counters->hardware) {
+                double ipc = total[s][0] ? (double)total[s][1] / total[s][0] : 0.0;
+                std::cout << std::setw(8) << std::fixed << std::setprecision(2) << ipc << std::defaultfloat;
+            }
+            std::cout << std::setprecision(3);
+#ifdef ALLOC_ACCOUNTING
+            std::cout << std::setw(10) << (double)total_allocations[s] / scans;
+#endif
+            if (counters->counts_syscalls) std::cout << std::setw(10) << (double)total_syscalls[s] / scans;
+            std::cout << std::setprecision(6) << std::endl;
+        }
+    }
+};
+
+// Totals captured after the warm-up, compared against later totals by check().
+struct SteadyStateCheck {
+    bool armed = false;
+    uint64_t allocations = 0;
+    uint64_t receive_syscalls = 0;
+    uint64_t other_syscalls = 0;
+    long batches = 0;
+
+    void mark(const StageProfile& p, long batch_count) {
+        armed = true;
+        allocations = p.all_allocations();
+        receive_syscalls = p.total_syscalls[RECEIVE];
+        other_syscalls = p.all_syscalls() - receive_syscalls;
+        batches = batch_count;
+    }
+
+    /**
+     * @brief Steady state = no allocation in any stage, at most one receive syscall per batch and
+     * no syscall in the other stages. Syscalls are only checked when the kernel counts them.
+     */
+    bool check(const StageProfile& p, long batch_count) const {
+        uint64_t new_allocations = p.all_allocations() - allocations;
+        uint64_t new_receive = p.total_syscalls[RECEIVE] - receive_syscalls;
+        uint64_t new_other = p.all_syscalls() - p.total_syscalls[RECEIVE] - other_syscalls;
+        uint64_t new_batches = batch_count - batches;
+        bool syscalls_ok = !p.counters->counts_syscalls || (new_receive <= new_batches && new_other == 0);
+        bool ok = new_allocations == 0 && syscalls_ok;
+        std::cout << (ok ? "[PASS]" : "[FAIL]") << " Steady state: " << new_allocations << " allocations, ";
+        if (p.counters->counts_syscalls) {
+            std::cout << new_receive << " receive syscalls for " << new_batches << " batches, "
+                      << new_other << " syscalls in other stages" << std::endl;
+        } else {
+            std::cout << "syscalls not counted (no raw_syscalls tracepoint)" << std::endl;
+        }
+        return ok;
+    }
+};
+
+// --- 5. Pipeline Stages ---
+
+/**
+ * @brief Byte-wise CRC-CCITT (0x1021 poly, 0x0000 init), same as checksum.cpp.
+ */
+unsigned short crc16_ccitt(const unsigned char* data, size_t length) {
+    unsigned short crc = 0x0000;
+    unsigned short poly = 0x1021;
+
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i] << 8;
+        for (int j = 0; j < 8; j++) {
+            if (crc & 0x8000) {
+                crc = (crc << 1) ^ poly;
+            } else {
+                crc <<= 1;
+            }
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief Decodes the measurement block with one memcpy per point, like process_packet_stack.
+ * @return Number of decoded points.
+ */
+size_t decode_points(const unsigned char* data, size_t length, std::vector<Point>& points) {
+    if (length < sizeof(SICK_DataOutput_Header)) return 0;
+    SICK_DataOutput_Header header;
+    std::memcpy(&header, data, sizeof(header));
+
+    size_t offset = le_to_h_u16(header.block_offset_size[2 * MEASUREMENT_DATA]);
+    size_t size = le_to_h_u16(header.block_offset_size[2 * MEASUREMENT_DATA + 1]);
+    if (size < 4 || offset + size > length) return 0;
+
+    uint32_t beams;
+    std::memcpy(&beams, data + offset, 4);
+    beams = le_to_h_u32(beams);
+    if (4 + (size_t)beams * 4 > size) return 0;
+
+    // Grows only until the largest scan has been seen once
+    points.resize(beams);
+    const unsigned char* data_ptr = data + offset + 4;
+    for (uint32_t i = 0; i < beams; i++) {
+        std::memcpy(&points[i], data_ptr, sizeof(Point));
+        points[i].distance_mm = le_to_h_u16(points[i].distance_mm);
+        data_ptr += sizeof(Point);
+    }
+    return beams;
+}
+
+// --- 5.1. Fused Copy and Checksum ---
+
+// Table for the MSB-first 0x1021 polynomial (same CRC as crc16_ccitt)
+static uint16_t crc16_table[256];
+// crc16_shift_table[k] = x^(8 * 2^k) mod P, for shifting a CRC over 2^k zero bytes
+static uint16_t crc16_shift_table[32];
+
+/**
+ * @brief Carry-less multiply of two 16-bit polynomials modulo x^16 + 0x1021.
+ */
+uint16_t crc16_mulmod(uint16_t a, uint16_t b) {
+    uint16_t product = 0;
+    for (int i = 15; i >= 0; i--) {
+        product = (product & 0x8000) ? (uint16_t)((product << 1) ^ 0x1021) : (uint16_t)(product << 1);
+        if (b & (1u << i)) product ^= a;
+    }
+    return product;
+}
+
+void initialize_crc16_tables() {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint16_t crc = i << 8;
+        for (int j = 0; j < 8; j++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        crc16_table[i] = crc;
+    }
+    uint16_t power = 0x0100; // x^8: one zero byte
+    for (int k = 0; k < 32; k++) {
+        crc16_shift_table[k] = power;
+        power = crc16_mulmod(power, power);
+    }
+}
+
+/**
+ * @brief CRC of A followed by B, from crc(A), crc(B) and len(B). Valid because the CRC has a
+ * zero init and no final XOR: crc(A || B) = crc(A) * x^(8 * len(B)) mod P  ^  crc(B).
+ */
+uint16_t crc16_combine(uint16_t crc_a, uint16_t crc_b, size_t length_b) {
+    for (int k = 0; length_b; k++, length_b >>= 1) {
+        if (length_b & 1) crc_a = crc16_mulmod(crc_a, crc16_shift_table[k]);
+    }
+    return crc_a ^ crc_b;
+}
+
+struct FragmentSum {
+    uint32_t offset = 0;
+    uint32_t length = 0;
+    uint8_t xor_sum = 0;        // calculate_xor_checksum() of the fragment
+    uint8_t add_sum = 0;        // calculate_sum_checksum() of the fragment
+    uint16_t crc = 0;           // crc16_ccitt() of the fragment on its own
+};
+
+/**
+ * @brief Copies a fragment into its slot and folds XOR, sum and CRC16 over the same bytes,
+ * so the payload is read once while it is still in registers/L1.
+ */
+FragmentSum copy_and_checksum(unsigned char* dst, const unsigned char* src, size_t length) {
+    FragmentSum sum;
+    sum.length = (uint32_t)length;
+    uint16_t crc = 0;
+    uint8_t x = 0;
+    uint32_t add = 0;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    __m128i xor_acc = _mm_setzero_si128();
+    __m128i sum_acc = _mm_setzero_si128();
+    const __m128i zero = _mm_setzero_si128();
+    alignas(16) unsigned char block[16];
+    for (; i + 16 <= length; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), v);
+        xor_acc = _mm_xor_si128(xor_acc, v);
+        sum_acc = _mm_add_epi64(sum_acc, _mm_sad_epu8(v, zero));
+        _mm_store_si128((__m128i*)block, v);
+        for (int b = 0; b < 16; b++) crc = (uint16_t)((crc << 8) ^ crc16_table[(crc >> 8) ^ block[b]]);
+    }
+    _mm_store_si128((__m128i*)block, xor_acc);
+    for (int b = 0; b < 16; b++) x ^= block[b];
+    add = (uint32_t)_mm_cvtsi128_si32(sum_acc) + (uint32_t)_mm_cvtsi128_si32(_mm_unpackhi_epi64(sum_acc, sum_acc));
+#endif
+
+    for (; i < length; i++) {
+        unsigned char c = src[i];
+        dst[i] = c;
+        x ^= c;
+        add += c;
+        crc = (uint16_t)((crc << 8) ^ crc16_table[(crc >> 8) ^ c]);
+    }
+    sum.xor_sum = x;
+    sum.add_sum = (uint8_t)add;
+    sum.crc = crc;
+    return sum;
+}
+
+struct ScanChecksums {
+    bool complete = false;      // Fragments cover the scan exactly once
+    uint8_t xor_sum = 0;
+    uint8_t add_sum = 0;
+    uint16_t crc = 0;
+};
+
+// --- 5.2. Batch Preamble Validation ---
+
+// Lanes per validation step; RECV_BATCH must be a multiple
+constexpr size_t VALIDATE_LANES = 8;
+static_assert(RECV_BATCH % VALIDATE_LANES == 0 && RECV_BATCH <= 32, "RECV_BATCH must fit the accept mask");
+
+struct PreambleBatch {
+    uint32_t accept = 0;                        // Bit i: datagram i is a well-formed MS3 fragment
+    uint32_t identification[RECV_BATCH];
+    uint32_t total_length[RECV_BATCH];
+    uint32_t offset[RECV_BATCH];
+    uint32_t length[RECV_BATCH];                // Payload bytes after the preamble
+};
+
+/**
+ * @brief Validates up to RECV_BATCH preambles without per-packet branches: magic and version
+ * ("MD" + version is one 32-bit compare), payload present, total_length <= MAX_SCAN_SIZE and
+ * offset + payload <= total_length. Every buffer must have MS3_PREAMBLE_SIZE readable bytes,
+ * even when the datagram is shorter (the receive buffers are MAX_PACKET_SIZE).
+ */
+void validate_preambles(const unsigned char* const* packets, const uint32_t* lengths, size_t count, PreambleBatch& out) {
+    alignas(32) uint32_t magic_lo[RECV_BATCH], magic_hi[RECV_BATCH], datagram[RECV_BATCH];
+    uint32_t want_lo, want_hi;
+    std::memcpy(&want_lo, "MS3 ", 4);
+    const unsigned char hi[4] = {'M', 'D', (unsigned char)(MS3_VERSION & 0xFF), (unsigned char)(MS3_VERSION >> 8)};
+    std::memcpy(&want_hi, hi, 4);
+
+    // Transpose the preambles into field arrays (lanes past `count` get length 0 and fail)
+    for (size_t i = 0; i < RECV_BATCH; i++) {
+        const unsigned char* p = packets[i < count ? i : 0];
+        MS3_Preamble pre;
+        std::memcpy(&pre, p, sizeof(pre));
+        std::memcpy(&magic_lo[i], pre.magic, 4);
+        std::memcpy(&magic_hi[i], pre.magic + 4, 4);  // "MD" + version (little endian on the wire)
+        out.total_length[i] = le_to_h_u32(pre.total_length);
+        out.identification[i] = le_to_h_u32(pre.identification);
+        out.offset[i] = le_to_h_u32(pre.fragment_offset);
+        datagram[i] = i < count ? lengths[i] : 0;
+        out.length[i] = datagram[i] - (uint32_t)MS3_PREAMBLE_SIZE;  // Wraps for short datagrams; masked below
+    }
+
+    uint32_t accept = 0;
+#if defined(__AVX2__)
+    // Unsigned compares via the sign-bit bias: a > b  <=>  (a ^ 0x80000000) >s (b ^ 0x80000000)
+    const __m256i bias = _mm256_set1_epi32((int)0x80000000u);
+    const __m256i v_want_lo = _mm256_set1_epi32((int)want_lo);
+    const __m256i v_want_hi = _mm256_set1_epi32((int)want_hi);
+    const __m256i v_min_len = _mm256_set1_epi32((int)(MS3_PREAMBLE_SIZE ^ 0x80000000u));
+    const __m256i v_max_total = _mm256_set1_epi32((int)((MAX_SCAN_SIZE + 1) ^ 0x80000000u));
+    for (size_t i = 0; i < RECV_BATCH; i += VALIDATE_LANES) {
+        __m256i lo = _mm256_load_si256((const __m256i*)(magic_lo + i));
+        __m256i hi_v = _mm256_load_si256((const __m256i*)(magic_hi + i));
+        __m256i len = _mm256_load_si256((const __m256i*)(datagram + i));
+        __m256i total = _mm256_loadu_si256((const __m256i*)(out.total_length + i));
+        __m256i offset = _mm256_loadu_si256((const __m256i*)(out.offset + i));
+        __m256i payload = _mm256_loadu_si256((const __m256i*)(out.length + i));
+
+        __m256i ok = _mm256_and_si256(_mm256_cmpeq_epi32(lo, v_want_lo), _mm256_cmpeq_epi32(hi_v, v_want_hi));
+        ok = _mm256_and_si256(ok, _mm256_cmpgt_epi32(_mm256_xor_si256(len, bias), v_min_len));
+        ok = _mm256_and_si256(ok, _mm256_cmpgt_epi32(v_max_total, _mm256_xor_si256(total, bias)));
+        // offset <= total and payload <= total - offset (no overflow in offset + payload)
+        __m256i room = _mm256_sub_epi32(total, offset);
+        ok = _mm256_andnot_si256(_mm256_cmpgt_epi32(_mm256_xor_si256(offset, bias), _mm256_xor_si256(total, bias)), ok);
+        ok = _mm256_andnot_si256(_mm256_cmpgt_epi32(_mm256_xor_si256(payload, bias), _mm256_xor_si256(room, bias)), ok);
+        accept |= (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(ok)) << i;
+    }
+#elif defined(__SSE2__)
+    const __m128i bias = _mm_set1_epi32((int)0x80000000u);
+    const __m128i v_want_lo = _mm_set1_epi32((int)want_lo);
+    const __m128i v_want_hi = _mm_set1_epi32((int)want_hi);
+    const __m128i v_min_len = _mm_set1_epi32((int)(MS3_PREAMBLE_SIZE ^ 0x80000000u));
+    const __m128i v_max_total = _mm_set1_epi32((int)((MAX_SCAN_SIZE + 1) ^ 0x80000000u));
+    for (size_t i = 0; i < RECV_BATCH; i += 4) {
+        __m128i lo = _mm_load_si128((const __m128i*)(magic_lo + i));
+        __m128i hi_v = _mm_load_si128((const __m128i*)(magic_hi + i));
+        __m128i len = _mm_load_si128((const __m128i*)(datagram + i));
+        __m128i total = _mm_loadu_si128((const __m128i*)(out.total_length + i));
+        __m128i offset = _mm_loadu_si128((const __m128i*)(out.offset + i));
+        __m128i payload = _mm_loadu_si128((const __m128i*)(out.length + i));
+
+        __m128i ok = _mm_and_si128(_mm_cmpeq_epi32(lo, v_want_lo), _mm_cmpeq_epi32(hi_v, v_want_hi));
+        ok = _mm_and_si128(ok, _mm_cmpgt_epi32(_mm_xor_si128(len, bias), v_min_len));
+        ok = _mm_and_si128(ok, _mm_cmpgt_epi32(v_max_total, _mm_xor_si128(total, bias)));
+        __m128i room = _mm_sub_epi32(total, offset);
+        ok = _mm_andnot_si128(_mm_cmpgt_epi32(_mm_xor_si128(offset, bias), _mm_xor_si128(total, bias)), ok);
+        ok = _mm_andnot_si128(_mm_cmpgt_epi32(_mm_xor_si128(payload, bias), _mm_xor_si128(room, bias)), ok);
+        accept |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(ok)) << i;
+    }
+#else
+    for (size_t i = 0; i < RECV_BATCH; i++) {
+        bool ok = magic_lo[i] == want_lo && magic_hi[i] == want_hi && datagram[i] > MS3_PREAMBLE_SIZE &&
+                  out.total_length[i] <= MAX_SCAN_SIZE && out.offset[i] <= out.total_length[i] &&
+                  out.length[i] <= out.total_length[i] - out.offset[i];
+        accept |= (uint32_t)ok << i;
+    }
+#endif
+    out.accept = accept;
+}
+
+// --- 5.3. Reassembly ---
+
+// Fixed reassembly table: slot = identification % REASSEMBLY_SLOTS, buffers allocated once.
+struct Reassembler {
+    struct Slot {
+        bool used = false;
+        uint32_t id = 0;
+        size_t total = 0;
+        size_t received = 0;
+        std::vector<unsigned char> data;
+        FragmentSum fragments[MAX_FRAGMENTS];
+        size_t fragment_count = 0;
+
+        /**
+         * @brief Combines the per-fragment sums (fused mode). Fragments may have arrived in any
+         * order; they are put in offset order first, which the CRC combine needs.
+         */
+        ScanChecksums checksums() {
+            ScanChecksums out;
+            std::sort(fragments, fragments + fragment_count,
+                      [](const FragmentSum& a, const FragmentSum& b) { return a.offset < b.offset; });
+            size_t expected = 0;
+            for (size_t f = 0; f < fragment_count; f++) {
+                const FragmentSum& frag = fragments[f];
+                if (frag.offset != expected) return out;
+                out.xor_sum ^= frag.xor_sum;
+                out.add_sum += frag.add_sum;
+                out.crc = crc16_combine(out.crc, frag.crc, frag.length);
+                expected += frag.length;
+            }
+            out.complete = expected == total;
+            return out;
+        }
+    };
+    Slot slots[REASSEMBLY_SLOTS];
+    long incomplete = 0;
+    bool fused = false;
+
+    Reassembler() {
+        for (Slot& slot : slots) slot.data.resize(MAX_SCAN_SIZE);
+    }
+
+    /**
+     * @brief Adds one datagram (per-packet validation, used outside the batch path).
+     * @return The slot holding the completed scan if this was its last fragment, nullptr otherwise.
+     * The slot stays valid until the next call.
+     */
+    Slot* add(const unsigned char* packet, size_t length) {
+        if (length <= MS3_PREAMBLE_SIZE || std::memcmp(packet, "MS3 MD", 6) != 0) return nullptr;
+        MS3_Preamble pre;
+        std::memcpy(&pre, packet, sizeof(pre));
+        uint32_t id = le_to_h_u32(pre.identification);
+        size_t total = le_to_h_u32(pre.total_length);
+        size_t frag_offset = le_to_h_u32(pre.fragment_offset);
+        size_t frag_len = length - MS3_PREAMBLE_SIZE;
+        if (total > MAX_SCAN_SIZE || frag_offset + frag_len > total) return nullptr;
+        return add_fragment(id, total, frag_offset, packet + MS3_PREAMBLE_SIZE, frag_len);
+    }
+
+    /**
+     * @brief Adds one fragment whose preamble has already been validated (validate_preambles).
+     */
+    Slot* add_fragment(uint32_t id, size_t total, size_t frag_offset, const unsigned char* payload, size_t frag_len) {
+        Slot& slot = slots[id % REASSEMBLY_SLOTS];
+        if (!slot.used || slot.id != id) {
+            // A newer scan takes over the slot; the old one lost a fragment
+            if (slot.used) incomplete++;
+            slot.used = true;
+            slot.id = id;
+            slot.total = total;
+            slot.received = 0;
+            slot.fragment_count = 0;
+        }
+        if (fused) {
+            if (slot.fragment_count == MAX_FRAGMENTS) return nullptr;
+            FragmentSum& frag = slot.fragments[slot.fragment_count++];
+            frag = copy_and_checksum(slot.data.data() + frag_offset, payload, frag_len);
+            frag.offset = (uint32_t)frag_offset;
+        } else {
+            std::memcpy(slot.data.data() + frag_offset, payload, frag_len);
+        }
+        slot.received += frag_len;
+        if (slot.received < slot.total) return nullptr;
+
+        slot.used = false;
+        return &slot;
+    }
+};
+
+/**
+ * @brief Feeds the recordings in reverse order (every scan's fragments arrive last-first) through a
+ * fused reassembler and compares the combined sums with the byte-wise reference functions.
+ */
+bool self_check_fused(const std::vector<std::vector<unsigned char>>& datagrams) {
+    static Reassembler check;
+    check.fused = true;
+    long scans = 0, matched = 0;
+    for (auto it = datagrams.rbegin(); it != datagrams.rend(); ++it) {
+        Reassembler::Slot* scan = check.add(it->data(), it->size());
+        if (!scan) continue;
+        ScanChecksums sums = scan->checksums();
+        uint8_t x = 0, add = 0;
+        for (size_t i = 0; i < scan->total; i++) {
+            x ^= scan->data[i];
+            add += scan->data[i];
+        }
+        scans++;
+        if (sums.complete && sums.crc == crc16_ccitt(scan->data.data(), scan->total) &&
+            sums.xor_sum == x && sums.add_sum == add) matched++;
+    }
+    std::cout << "Fused copy+checksum self-check (fragments out of order): " << matched << "/" << scans
+              << " scans match crc16_ccitt / XOR / sum" << std::endl;
+    return matched == scans;
+}
+
+// --- 6. Main Program Loop ---
+
+int main(int argc, char** argv) {
+    std::string folder;
+    int repeat = 1;
+    bool assert_steady = false;
+    bool fused = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--assert-steady-state") assert_steady = true;
+        else if (arg == "--fused") fused = true;
+        else if (arg == "--dir" && i + 1 < argc) folder = argv[++i];
+        else if (arg == "--repeat" && i + 1 < argc) repeat = std::max(1, std::atoi(argv[++i]));
+    }
+
+    StageCounters counters;
+    if (!counters.open()) {
+        std::cerr << "[WARNING] perf_event_open unavailable (" << strerror(errno)
+                  << "), reporting wall time only." << std::endl;
+    } else if (!counters.hardware) {
+        std::cerr << "[WARNING] Hardware counters unavailable, using software counters." << std::endl;
+    }
+
+    StageProfile profile;
+    profile.counters = &counters;
+    SteadyStateCheck steady;
+    static Reassembler reassembler;  // ~512 KB of slot buffers
+    reassembler.fused = fused;
+    initialize_crc16_tables();
+    std::vector<Point> points;
+    std::vector<Point> published;    // Latest decoded scan, read by consumers
+    long scans = 0;
+    long batches = 0;
+    bool steady_ok = true;
+    unsigned long long crc_sink = 0; // Keeps the checksum stage from being optimised away
+
+    PreambleBatch batch;
+    long rejected = 0;
+
+    auto finish_scan = [&](Reassembler::Slot* scan) {
+        if (fused) {
+            ScanChecksums sums = scan->checksums();
+            crc_sink += sums.complete ? sums.crc : 0;
+        } else {
+            crc_sink += crc16_ccitt(scan->data.data(), scan->total);
+        }
+        profile.boundary(CHECKSUM);
+
+        size_t n = decode_points(scan->data.data(), scan->total, points);
+        profile.boundary(DECODE);
+        if (n == 0) return;
+
+        published = points;
+        profile.boundary(PUBLISH);
+
+        scans++;
+        if (assert_steady && scans == WARMUP_SCANS) steady.mark(profile, batches);
+        if (scans % REPORT_SCANS == 0) {
+            profile.report(scans);
+            if (steady.armed) steady_ok = steady.check(profile, batches) && steady_ok;
+            profile.start();  // The report's own write() calls are not charged to the next stage
+        }
+    };
+
+    // One receive batch: validate all preambles at once, then hand the accepted fragments over
+    auto process_batch = [&](const unsigned char* const* packets, const uint32_t* lengths, size_t count) {
+        validate_preambles(packets, lengths, count, batch);
+        rejected += (long)count - __builtin_popcount(batch.accept);
+        if (batch.accept == 0) profile.boundary(REASSEMBLE);
+        for (uint32_t mask = batch.accept; mask; mask &= mask - 1) {
+            int i = __builtin_ctz(mask);
+            Reassembler::Slot* scan = reassembler.add_fragment(batch.identification[i], batch.total_length[i],
+                                                               batch.offset[i], packets[i] + MS3_PREAMBLE_SIZE, batch.length[i]);
+            profile.boundary(REASSEMBLE);
+            if (scan) finish_scan(scan);
+        }
+    };
+
+    if (!folder.empty()) {
+        // Offline: load the recordings once, then replay them from memory
+        std::vector<fs::path> files;
+        for (const auto& entry : fs::directory_iterator(folder)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".bin") files.push_back(entry.path());
+        }
+        std::sort(files.begin(), files.end());
+        std::vector<std::vector<unsigned char>> datagrams;
+        for (const auto& path : files) {
+            std::ifstream file(path, std::ios::binary);
+            datagrams.emplace_back((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        }
+        // Replayed in receive-sized batches; buffers are padded so every preamble is readable
+        std::vector<std::vector<unsigned char>> padded(datagrams);
+        std::vector<const unsigned char*> pointers;
+        std::vector<uint32_t> lengths;
+        for (size_t d = 0; d < datagrams.size(); d++) {
+            padded[d].resize(std::max(padded[d].size(), MS3_PREAMBLE_SIZE));
+            pointers.push_back(padded[d].data());
+            lengths.push_back((uint32_t)datagrams[d].size());
+        }
+        if (fused && !self_check_fused(datagrams)) return 1;
+        std::cout << "--- Profiling " << datagrams.size() << " recorded datagrams x " << repeat
+                  << (fused ? " (fused copy+checksum)" : "") << " ---" << std::endl;
+
+        profile.start();
+        for (int r = 0; r < repeat; r++) {
+            for (size_t first = 0; first < pointers.size(); first += RECV_BATCH) {
+                size_t count = std::min<size_t>(RECV_BATCH, pointers.size() - first);
+                process_batch(&pointers[first], &lengths[first], count);
+                batches++;
+            }
+        }
+        if (scans > 0) profile.report(scans);
+        std::cout << "(crc sink " << crc_sink << ", " << reassembler.incomplete << " incomplete scans, "
+                  << rejected << " datagrams rejected)" << std::endl;
+        if (steady.armed) steady_ok = steady.check(profile, batches) && steady_ok;
+        return steady_ok ? 0 : 1;
+    }
+
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd < 0) { std::cerr << "Error: Could not create socket." << std::endl; return 1; }
+    int reuse = 1;
+    setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(PORT);
+    if (bind(sockfd, (sockaddr*)&addr, sizeof(addr)) < 0) { std::cerr << "Error: Could not bind to port " << PORT << std::endl; close(sockfd); return 1; }
+
+    std::cout << "--- Profiling live pipeline on port " << PORT << " ---" << std::endl;
+
+    static unsigned char packet_buffers[RECV_BATCH][MAX_PACKET_SIZE];
+    const unsigned char* packet_pointers[RECV_BATCH];
+    uint32_t packet_lengths[RECV_BATCH];
+    iovec iovs[RECV_BATCH];
+    mmsghdr msgs[RECV_BATCH];
+    std::memset(msgs, 0, sizeof(msgs));
+    for (unsigned i = 0; i < RECV_BATCH; i++) {
+        iovs[i].iov_base = packet_buffers[i];
+        iovs[i].iov_len = MAX_PACKET_SIZE;
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        packet_pointers[i] = packet_buffers[i];
+    }
+
+    profile.start();
+    while (steady_ok || !assert_steady) {
+        // Blocking receive: waiting time is charged to the receive stage, like the real loop
+        int received = recvmmsg(sockfd, msgs, RECV_BATCH, MSG_WAITFORONE, nullptr);
+        profile.boundary(RECEIVE);
+        batches++;  // One recvmmsg() call, even when interrupted
+        if (received < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Error in recvmmsg: " << strerror(errno) << std::endl;
+            break;
+        }
+        for (int i = 0; i < received; i++) packet_lengths[i] = msgs[i].msg_len;
+        process_batch(packet_pointers, packet_lengths, received);
+    }
+
+    close(sockfd);
+    return steady_ok ? 0 : 1;
+}